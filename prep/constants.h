@@ -25,15 +25,26 @@
 #ifndef __CONSTANTS_H
 #define __CONSTANTS_H
 
-#include <atomic>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <cstdlib>
 
 namespace SMITH3 {
 namespace Prep {
 
+/// If SMITH3_SPEC is set, the equation specification read by SMITH3 at run time is printed instead of main.cc.
+static bool spec() {
+  static const bool out = getenv("SMITH3_SPEC") != nullptr;
+  return out;
+}
+
 static std::string header() {
   std::stringstream mm;
+  if (spec()) {
+    mm << "# SMITH3 equation specification. Run as SMITH3 <this file>." << std::endl;
+    return mm.str();
+  }
   mm << "//" << std::endl;
   mm << "// SMITH3 - generates spin-free multireference electron correlation programs." << std::endl;
   mm << "// Filename: main.cc" << std::endl;
@@ -68,11 +79,28 @@ static std::string header() {
   mm << "#include \"forest.h\"" << std::endl;
   mm << "#include \"residual.h\"" << std::endl;
   mm << "#include \"energy.h\"" << std::endl;
+  mm << "#include \"stats.h\"" << std::endl;
+  mm << "#include \"spec.h\"" << std::endl;
   mm << "" << std::endl;
   mm << "using namespace std;" << std::endl;
   mm << "using namespace smith;" << std::endl;
   mm << "" << std::endl;
-  mm << "int main() {" << std::endl;
+  mm << "int main(int argc, char** argv) {" << std::endl;
+  mm << "" << std::endl;
+  mm << "  // equations can instead be read from a specification printed by Prep" << std::endl;
+  mm << "  if (argc > 1) {" << std::endl;
+  mm << "    Spec(argv[1]).generate();" << std::endl;
+  mm << "    return 0;" << std::endl;
+  mm << "  }" << std::endl;
+  return mm.str();
+}
+
+static std::string theory_str(const std::string theory) {
+  std::stringstream mm;
+  if (spec())
+    mm << "theory " << theory << std::endl;
+  else
+    mm << "  string theory=\"" << theory << "\";" << std::endl;
   return mm.str();
 }
 
@@ -82,21 +110,35 @@ static std::string footer(const std::string res, const std::string energy = "",
                           const std::string source = "", const std::string norm = "") {
   std::stringstream mm;
 
+  // trees in the forest, and trees printed with their titles
+  std::vector<std::string> trees;
+  for (auto& i : {res, source, energy, correction, density, density1, density2, dedci, dedci2, dedci3, dedci4, norm})
+    if (!i.empty()) trees.push_back(i);
+  std::vector<std::pair<std::string, std::string>> output;
+  if (!res.empty())        output.push_back(std::make_pair(res, "   ***  Residual  ***"));
+  if (!source.empty())     output.push_back(std::make_pair(source, "   ***  Source  ***"));
+  if (!energy.empty())     output.push_back(std::make_pair(energy, "   ***  Energy E2 ***"));
+  if (!correction.empty()) output.push_back(std::make_pair(correction, "   ***  Correlated norm <1|1> ***"));
+  if (!norm.empty())       output.push_back(std::make_pair(norm, "   ***  Norm <omega|1> ***"));
+  if (!density.empty())    output.push_back(std::make_pair(density, "   ***  Correlated one-body density matrix d2 ***"));
+  if (!density1.empty())   output.push_back(std::make_pair(density1, "   ***  Correlated one-body density matrix d1 ***"));
+  if (!density2.empty())   output.push_back(std::make_pair(density2, "   ***  Correlated two-body density matrix D1 ***"));
+  if (!dedci.empty())      output.push_back(std::make_pair(dedci, "   ***  CI derivative  ***"));
+  if (!dedci2.empty())     output.push_back(std::make_pair(dedci2, "   ***  CI derivative 2 ***"));
+  if (!dedci3.empty())     output.push_back(std::make_pair(dedci3, "   ***  CI derivative 3 ***"));
+  if (!dedci4.empty())     output.push_back(std::make_pair(dedci4, "   ***  CI derivative 4 ***"));
+
+  if (spec()) {
+    mm << "trees";
+    for (auto& i : trees) mm << " " << i;
+    mm << std::endl;
+    for (auto& i : output) mm << "print " << i.first << " " << i.second << std::endl;
+    return mm.str();
+  }
+
   mm << "  list<shared_ptr<Tree>> trees = {";
-  std::atomic_flag done;
-  done.clear();
-  if (!res.empty())        mm << (done.test_and_set() ? ", " : "") << res;
-  if (!source.empty())     mm << (done.test_and_set() ? ", " : "") << source;
-  if (!energy.empty())     mm << (done.test_and_set() ? ", " : "") << energy;
-  if (!correction.empty()) mm << (done.test_and_set() ? ", " : "") << correction;
-  if (!density.empty())    mm << (done.test_and_set() ? ", " : "") << density;
-  if (!density1.empty())   mm << (done.test_and_set() ? ", " : "") << density1;
-  if (!density2.empty())   mm << (done.test_and_set() ? ", " : "") << density2;
-  if (!dedci.empty())      mm << (done.test_and_set() ? ", " : "") << dedci;
-  if (!dedci2.empty())     mm << (done.test_and_set() ? ", " : "") << dedci2;
-  if (!dedci3.empty())     mm << (done.test_and_set() ? ", " : "") << dedci3;
-  if (!dedci4.empty())     mm << (done.test_and_set() ? ", " : "") << dedci4;
-  if (!norm.empty())       mm << (done.test_and_set() ? ", " : "") << norm;
+  for (auto i = trees.begin(); i != trees.end(); ++i)
+    mm << (i != trees.begin() ? ", " : "") << *i;
   mm <<  "};" << std::endl;
   mm << "  auto fr = make_shared<Forest>(trees);" << std::endl;
 
@@ -127,57 +169,13 @@ static std::string footer(const std::string res, const std::string energy = "",
   mm << "  ds.close();" << std::endl;
   mm << "  gs.close();" << std::endl;
   mm << "  gg.close();" << std::endl;
+  mm << "  Stats::get().write(fr->name() + \"_stats.json\");" << std::endl;
   mm << "  cout << std::endl;" << std::endl;
   mm << "" <<  std::endl;
   mm << "  // output" << std::endl;
-  if (!res.empty()) {
-    mm << "  cout << std::endl << \"   ***  Residual  ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << res << "->print();" << std::endl;
-  }
-  if (!source.empty()) {
-    mm << "  cout << std::endl << \"   ***  Source  ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << source << "->print();" << std::endl;
-  }
-
-  if (!energy.empty()) {
-    mm << "  cout << std::endl << \"   ***  Energy E2 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << energy << "->print();" << std::endl;
-  }
-  if (!correction.empty()) {
-    mm << "  cout << std::endl << \"   ***  Correlated norm <1|1> ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << correction << "->print();" << std::endl;
-  }
-  if (!norm.empty()) {
-    mm << "  cout << std::endl << \"   ***  Norm <omega|1> ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << norm << "->print();" << std::endl;
-  }
-  if (!density.empty()) {
-    mm << "  cout << std::endl << \"   ***  Correlated one-body density matrix d2 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << density << "->print();" << std::endl;
-  }
-  if (!density1.empty()) {
-    mm << "  cout << std::endl << \"   ***  Correlated one-body density matrix d1 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << density1 << "->print();" << std::endl;
-  }
-  if (!density2.empty()) {
-    mm << "  cout << std::endl << \"   ***  Correlated two-body density matrix D1 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << density2 << "->print();" << std::endl;
-  }
-  if (!dedci.empty()) {
-    mm << "  cout << std::endl << \"   ***  CI derivative  ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << dedci << "->print();" << std::endl;
-  }
-  if (!dedci2.empty()) {
-    mm << "  cout << std::endl << \"   ***  CI derivative 2 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << dedci2 << "->print();" << std::endl;
-  }
-  if (!dedci3.empty()) {
-    mm << "  cout << std::endl << \"   ***  CI derivative 3 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << dedci3 << "->print();" << std::endl;
-  }
-  if (!dedci4.empty()) {
-    mm << "  cout << std::endl << \"   ***  CI derivative 4 ***\" << std::endl << std::endl;" << std::endl;
-    mm << "  " << dedci4 << "->print();" << std::endl;
+  for (auto& i : output) {
+    mm << "  cout << std::endl << \"" << i.second << "\" << std::endl << std::endl;" << std::endl;
+    mm << "  " << i.first << "->print();" << std::endl;
   }
   mm << "  cout << std::endl << std::endl;" << std::endl;
   mm << "" <<  std::endl;
@@ -87,6 +87,15 @@ class Diagram {
       return ss.str();
     };
 
+    std::string spec_str() const {
+      std::stringstream ss;
+      ss << "diagram " << label() << " " << fac_ << " " << (scalar().empty() ? "-" : scalar()) << " "
+         << (!ci_derivative_ ? "0 0" : (braket_.first == true ? "1 0" : "0 1"));
+      for (auto& j : op_) ss << " " << j->tag();
+      ss << std::endl;
+      return ss.str();
+    }
+
     std::string equation_str() const {
       std::stringstream ss;
       ss << "  auto " << eqn_label() << " = make_shared<Equation>(" << diag_label() << ", theory);" << std::endl;
@@ -130,6 +130,15 @@ class Equation {
 
     std::string generate() const {
       std::stringstream ss;
+      if (spec()) {
+        if (tree_type_ != "residual" && tree_type_ != "energy")
+          throw std::logic_error("prep/equation.cc error, tree must be of derived type");
+        const bool simplify = method_ != "CASPT2" && method_ != "RelCASPT2" && method_ != "MSCASPT2" && method_ != "SPCASPT2";
+        ss << "equation " << tree_label() << " " << tree_type_ << " " << tree_name_ << " " << ci_derivative_ << " " << simplify << std::endl;
+        for (auto& i : diagram_) ss << i->spec_str();
+        ss << "end" << std::endl;
+        return ss.str();
+      }
       for (auto& i : diagram_) ss << i->construct_str();
       for (auto& i : diagram_) ss << i->diagram_str();
       for (auto& i : diagram_) ss << i->equation_str();
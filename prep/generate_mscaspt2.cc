@@ -101,7 +101,7 @@ int main() {
   vector<shared_ptr<Tensor>> dum = {shared_ptr<Tensor>(new Tensor("proj", "e", {}))};
   vector<shared_ptr<Tensor>> ex1b = {shared_ptr<Tensor>(new Tensor("1b", {"g", "g"}))};
 
-  cout << "  string theory=\"" << theory << "\";" << endl;
+  cout << theory_str(theory);
   cout << endl;
 
   for (auto& i : proj_list) cout << i->generate();
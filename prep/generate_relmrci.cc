@@ -92,7 +92,7 @@ int main() {
   vector<shared_ptr<Tensor>> H   = {shared_ptr<Tensor>(new Tensor("v2", "", {"g", "g", "g", "g"}))};
   vector<shared_ptr<Tensor>> dum = {shared_ptr<Tensor>(new Tensor("proj", "e", {}))};
 
-  cout << "  string theory=\"" << theory << "\";" << endl;
+  cout << theory_str(theory);
   cout << endl;
 
   for (auto& i : proj_list) cout << i->generate();
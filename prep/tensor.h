@@ -35,6 +35,7 @@
 #include <cassert>
 #include <sstream>
 #include <initializer_list>
+#include "constants.h"
 
 namespace SMITH3 {
 namespace Prep {
@@ -70,6 +71,12 @@ class Tensor {
 
     std::string generate() const {
       std::stringstream ss;
+      if (spec()) {
+        ss << "op " << tag_ << " " << (base_.empty() ? "-" : base_) << " " << alpha_;
+        for (auto& i : indices_) ss << " " << i;
+        ss << std::endl;
+        return ss.str();
+      }
       std::string al = alpha_ ? ", true" : "";
       if (!base_.empty()) {
         ss << "  shared_ptr<Operator> " << tag_ << " = make_shared<Op>(\"" << base_ << "\"" << (indices_.empty() ? "" : ", ") << str_index() << al << ");" << std::endl;
@@ -24,9 +24,16 @@
 
 
 #include <algorithm>
+#include <functional>
 #include <iomanip>
 #include <stdexcept>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 #include "active.h"
+#include "flatrdm.h"
+#include "stats.h"
+#include "diskcache.h"
 
 using namespace std;
 using namespace smith;
@@ -34,18 +41,233 @@ using namespace smith;
 
 
 Active::Active(const list<shared_ptr<const Index>>& in, pair<bool,bool> braket) : bra_(braket.first), ket_(braket.second) {
+  // reductions are shared among index lists that are the same up to relabeling
+  static unordered_map<string, shared_ptr<const ActivePattern>> cache;
+  static mutex cache_mutex;
+
+  const string k = key(in, braket);
+  {
+    lock_guard<mutex> lock(cache_mutex);
+    auto iter = cache.find(k);
+    if (iter != cache.end()) {
+      apply(*iter->second, in);
+      Stats::get().add("active", "reused");
+      return;
+    }
+  }
+  {
+    auto p = make_shared<ActivePattern>();
+    string value;
+    if (DiskCache::get().load("active", k, value) && p->read(value)) {
+      apply(*p, in);
+      Stats::get().add("active", "cache_hits");
+      lock_guard<mutex> lock(cache_mutex);
+      cache.insert(make_pair(k, p));
+      return;
+    }
+  }
+
   shared_ptr<RDM> tmp;
   if (!braket.first && !braket.second) {
-    tmp = make_shared<RDM00>(in, map<shared_ptr<const Index>, shared_ptr<const Index>>(), braket, 1.0);
+    tmp = make_shared<RDM00>(in, map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder>(), braket, 1.0);
   } else if (braket.first || braket.second) {
     // Caution, braket is passed directly so both modified rdms <I|E|0> and <0|E|I> are made here.
-    tmp = make_shared<RDMI0>(in, map<shared_ptr<const Index>, shared_ptr<const Index>>(), braket, 1.0);
+    tmp = make_shared<RDMI0>(in, map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder>(), braket, 1.0);
   } else if (braket.first && braket.second) {
     throw logic_error("Active::ctor not implemented");
   }
   // this sets list<RDM>
   reduce(tmp);
 
+  shared_ptr<const ActivePattern> p = pattern(in);
+  if (p) {
+    DiskCache::get().store("active", k, p->str());
+    lock_guard<mutex> lock(cache_mutex);
+    cache.insert(make_pair(k, p));
+  }
+}
+
+
+string ActivePattern::str() const {
+  stringstream ss;
+  ss << setprecision(17);
+  ss << core.size() << "\n";
+  for (auto& c : core) ss << c.input << " " << c.space << " " << c.num << " " << c.dagger << "\n";
+  ss << slot.size() << "\n";
+  for (auto& s : slot) ss << s.input << " " << s.core << " " << s.spin << "\n";
+  ss << rdm.size() << "\n";
+  for (auto& t : rdm) {
+    ss << t.derived << " " << t.fac << " " << t.bra << " " << t.ket << " " << t.index.size();
+    for (auto& i : t.index) ss << " " << i;
+    ss << " " << t.delta.size();
+    for (auto& i : t.delta) ss << " " << i.first << " " << i.second;
+    ss << "\n";
+  }
+  ss << num_map.size();
+  for (auto& i : num_map) ss << " " << i.first << " " << i.second;
+  ss << "\n";
+  return ss.str();
+}
+
+
+bool ActivePattern::read(const string& in) {
+  stringstream ss(in);
+  size_t n;
+  ss >> n;
+  core.resize(n);
+  for (auto& c : core) ss >> c.input >> c.space >> c.num >> c.dagger;
+  ss >> n;
+  slot.resize(n);
+  for (auto& s : slot) ss >> s.input >> s.core >> s.spin;
+  ss >> n;
+  rdm.resize(n);
+  for (auto& t : rdm) {
+    ss >> t.derived >> t.fac >> t.bra >> t.ket >> n;
+    t.index.resize(n);
+    for (auto& i : t.index) ss >> i;
+    ss >> n;
+    t.delta.resize(n);
+    for (auto& i : t.delta) ss >> i.first >> i.second;
+  }
+  ss >> n;
+  for (size_t i = 0; i != n; ++i) {
+    int a, b;
+    ss >> a >> b;
+    num_map[a] = b;
+  }
+  return !ss.fail();
+}
+
+
+string Active::key(const list<shared_ptr<const Index>>& in, pair<bool,bool> braket) {
+  // objects, cores, numbers and spins are replaced by the position of their first appearance
+  vector<shared_ptr<const Index>> object;
+  vector<shared_ptr<Index_Core>> core;
+  vector<int> num;
+  vector<shared_ptr<const Spin>> spin;
+  stringstream ss;
+  ss << braket.first << braket.second;
+  for (auto& i : in) {
+    auto o = find(object.begin(), object.end(), i);
+    auto c = find(core.begin(), core.end(), i->core());
+    auto n = find(num.begin(), num.end(), i->num());
+    auto s = find(spin.begin(), spin.end(), i->spin());
+    ss << " " << i->space() << (i->dagger() ? "+" : "") << (o - object.begin()) << "." << (c - core.begin()) << "." << (n - num.begin())
+       << "." << (s - spin.begin()) << (i->spin()->alpha() ? "*" : "");
+    if (o == object.end()) object.push_back(i);
+    if (c == core.end()) core.push_back(i->core());
+    if (n == num.end()) num.push_back(i->num());
+    if (s == spin.end()) spin.push_back(i->spin());
+  }
+  return ss.str();
+}
+
+
+shared_ptr<const ActivePattern> Active::pattern(const list<shared_ptr<const Index>>& in) const {
+  const vector<shared_ptr<const Index>> input(in.begin(), in.end());
+  auto position = [&input](function<bool(const shared_ptr<const Index>&)> f) {
+    return static_cast<int>(find_if(input.begin(), input.end(), f) - input.begin());
+  };
+  const int size = input.size();
+
+  // all the index objects, ordered by construction so that the maps keyed on them are made in the same order
+  vector<shared_ptr<const Index>> object;
+  auto add = [&object](const shared_ptr<const Index>& i) {
+    if (find(object.begin(), object.end(), i) == object.end()) object.push_back(i);
+  };
+  for (auto& r : rdm_) {
+    for (auto& i : r->index()) add(i);
+    for (auto& i : r->delta()) {
+      add(i.first);
+      add(i.second);
+    }
+  }
+  sort(object.begin(), object.end(), IndexOrder());
+
+  auto out = make_shared<ActivePattern>();
+  vector<shared_ptr<Index_Core>> core;
+  for (auto& i : object) {
+    ActivePattern::Slot slot;
+    slot.input = position([&i](const shared_ptr<const Index>& j) { return j == i; });
+    slot.spin  = i->has_spin() ? position([&i](const shared_ptr<const Index>& j) { return j->spin() == i->spin(); }) : -1;
+    if (slot.spin == size) return nullptr;
+    if (slot.input == size) slot.input = -1;
+
+    auto c = find(core.begin(), core.end(), i->core());
+    slot.core = c - core.begin();
+    if (c == core.end()) {
+      ActivePattern::Core n;
+      n.input = position([&i](const shared_ptr<const Index>& j) { return j->core() == i->core(); });
+      n.space = i->space();
+      n.num = position([&i](const shared_ptr<const Index>& j) { return j->num() == i->num(); });
+      n.dagger = i->dagger();
+      if (n.input == size) n.input = -1;
+      if (n.num == size) return nullptr;
+      core.push_back(i->core());
+      out->core.push_back(n);
+    }
+    out->slot.push_back(slot);
+  }
+
+  auto id = [&object](const shared_ptr<const Index>& i) { return static_cast<int>(find(object.begin(), object.end(), i) - object.begin()); };
+  for (auto& r : rdm_) {
+    ActivePattern::Term term;
+    term.derived = static_cast<bool>(dynamic_pointer_cast<const RDMI0>(r));
+    term.fac = r->factor();
+    term.bra = r->bra();
+    term.ket = r->ket();
+    for (auto& i : r->index()) term.index.push_back(id(i));
+    for (auto& i : r->delta()) term.delta.push_back(make_pair(id(i.first), id(i.second)));
+    out->rdm.push_back(term);
+  }
+
+  for (auto& i : num_map_) {
+    const int a = position([&i](const shared_ptr<const Index>& j) { return j->num() == i.first; });
+    const int b = position([&i](const shared_ptr<const Index>& j) { return j->num() == i.second; });
+    if (a == size || b == size) return nullptr;
+    out->num_map.insert(make_pair(a, b));
+  }
+  return out;
+}
+
+
+void Active::apply(const ActivePattern& p, const list<shared_ptr<const Index>>& in) {
+  const vector<shared_ptr<const Index>> input(in.begin(), in.end());
+
+  vector<shared_ptr<Index_Core>> core;
+  for (auto& c : p.core) {
+    if (c.input >= 0) {
+      core.push_back(input[c.input]->core());
+    } else {
+      core.push_back(arena_shared<Index_Core>(IndexMap::get().label(c.space), c.dagger));
+      core.back()->set_num(input[c.num]->num());
+    }
+  }
+
+  vector<shared_ptr<const Index>> object;
+  for (auto& s : p.slot) {
+    if (s.input >= 0) {
+      object.push_back(input[s.input]);
+    } else {
+      auto i = arena_shared<Index>(core[s.core]);
+      if (s.spin >= 0) i->set_spin(input[s.spin]->spin());
+      object.push_back(i);
+    }
+  }
+
+  for (auto& t : p.rdm) {
+    list<shared_ptr<const Index>> index;
+    for (auto& i : t.index) index.push_back(object[i]);
+    map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder> delta;
+    for (auto& i : t.delta) delta.insert(make_pair(object[i.first], object[i.second]));
+    if (t.derived)
+      rdm_.push_back(make_shared<RDMI0>(index, delta, make_pair(t.bra, t.ket), t.fac));
+    else
+      rdm_.push_back(make_shared<RDM00>(index, delta, make_pair(t.bra, t.ket), t.fac));
+  }
+
+  for (auto& i : p.num_map)
+    num_map_[input[i.first]->num()] = input[i.second]->num();
 }
 
 
@@ -63,7 +285,7 @@ void Active::reduce(shared_ptr<RDM> in) {
     // reindex
     list<shared_ptr<const Index>> new_index;
     for (auto i : cindex) {
-      shared_ptr<const Index> tmp = make_shared<const Index>((*i), num_map[i->num()]);
+      shared_ptr<const Index> tmp = arena_shared<const Index>((*i), num_map[i->num()]);
       new_index.push_back(tmp);
     }
     shared_ptr<RDM> tmp = make_shared<RDMI0>(*in, new_index);
@@ -71,28 +293,53 @@ void Active::reduce(shared_ptr<RDM> in) {
   }
 
 
-  list<int> d;
-  list<pair<shared_ptr<RDM>, list<int>> > buf(1, make_pair(in,d));
-
-  while (buf.size() != 0) {
-    list<pair<shared_ptr<RDM>, list<int>> > buf2;
-
-    for (auto& it : buf) {
-      shared_ptr<RDM> tmp = it.first;
-      list<int> done = it.second;
-      // taking delta
-      list<shared_ptr<RDM>> out = tmp->reduce_one(done);
-      // this is also needed!
-      out.push_back(tmp);
-      for (auto& i : out) {
-        if (i->reduce_done(done)) {
-          rdm_.push_back(i);
-        } else {
-          buf2.push_back(make_pair(i,done));
+  if (FlatRDM::supported(*in)) {
+    // the same expansion on the compact encoding; only the final RDMs are made
+    list<pair<FlatRDM, unsigned int>> buf(1, make_pair(FlatRDM(in), 0u));
+
+    while (buf.size() != 0) {
+      list<pair<FlatRDM, unsigned int>> buf2;
+
+      for (auto& it : buf) {
+        unsigned int done = it.second;
+        // taking delta
+        vector<FlatRDM> out = it.first.reduce_one(done);
+        // this is also needed!
+        out.push_back(it.first);
+        for (auto& i : out) {
+          if (i.reduce_done(done)) {
+            rdm_.push_back(i.rdm());
+          } else {
+            buf2.push_back(make_pair(i,done));
+          }
+        }
+      }
+      buf = buf2;
+    }
+  } else {
+    list<int> d;
+    list<pair<shared_ptr<RDM>, list<int>> > buf(1, make_pair(in,d));
+
+    while (buf.size() != 0) {
+      list<pair<shared_ptr<RDM>, list<int>> > buf2;
+
+      for (auto& it : buf) {
+        shared_ptr<RDM> tmp = it.first;
+        list<int> done = it.second;
+        // taking delta
+        list<shared_ptr<RDM>> out = tmp->reduce_one(done);
+        // this is also needed!
+        out.push_back(tmp);
+        for (auto& i : out) {
+          if (i->reduce_done(done)) {
+            rdm_.push_back(i);
+          } else {
+            buf2.push_back(make_pair(i,done));
+          }
         }
       }
+      buf = buf2;
     }
-    buf = buf2;
   }
 
   for (auto& i : rdm_)
@@ -136,31 +383,27 @@ bool Active::operator==(const Active& o) const {
 }
 
 
-string Active::generate(const string indent, const string tag, const list<shared_ptr<const Index>> index, const list<shared_ptr<const Index>> merged, const string mlab, const bool use_blas) const {
+string Active::generate(const string indent, const string tag, const list<shared_ptr<const Index>> index, const list<shared_ptr<const Index>> merged, const vector<string>& mlab, const bool use_blas) const {
   stringstream dd;
 
-  vector<string> in_tensors = required_rdm(!merged.empty());
-  if (!merged.empty()) {
-    in_tensors.push_back(mlab);
-  }
+  vector<string> in_tensors = required_rdm(mlab.size() == 1);
+  in_tensors.insert(in_tensors.end(), mlab.begin(), mlab.end());
 
   for (auto& i : rdm_) {
-    dd << i->generate(indent, tag, index, merged, mlab, in_tensors, use_blas);
+    dd << i->generate(indent, tag, index, merged, mlab.empty() ? "" : mlab.front(), in_tensors, use_blas);
   }
   return dd.str();
 }
 
 
-string Active::generate_sources(const string indent, const string tag, const list<shared_ptr<const Index>> index, const list<shared_ptr<const Index>> merged, const string mlab, const bool use_blas) const {
+string Active::generate_sources(const string indent, const string tag, const list<shared_ptr<const Index>> index, const list<shared_ptr<const Index>> merged, const vector<string>& mlab, const bool use_blas) const {
   stringstream dd;
 
-  vector<string> in_tensors = required_rdm(!merged.empty());
-  if (!merged.empty()) {
-    in_tensors.push_back(mlab);
-  }
+  vector<string> in_tensors = required_rdm(mlab.size() == 1);
+  in_tensors.insert(in_tensors.end(), mlab.begin(), mlab.end());
 
   for (auto& i : rdm_) {
-    dd << i->generate_sources(indent, tag, index, merged, mlab, in_tensors, use_blas);
+    dd << i->generate_sources(indent, tag, index, merged, mlab.empty() ? "" : mlab.front(), in_tensors, use_blas);
   }
   return dd.str();
 }
@@ -180,6 +423,13 @@ vector<string> Active::required_rdm(const bool merged) const {
     }
   } else {
     for (auto& i : rdm_) {
+      // 4-RDMs rebuilt from their cumulants need rdm1-rdm3 instead
+      if (i->cumulant()) {
+        for (auto& j : {"rdm1", "rdm2", "rdm3"})
+          if (find(out.begin(), out.end(), j) == out.end())
+            out.push_back(j);
+        continue;
+      }
       // rdm0 does need to be included in header for multistate cases
       stringstream ss;
       if (i->rank() != 0 && i->index().front()->spin()->alpha())
@@ -203,15 +453,30 @@ void Active::merge(shared_ptr<const Active> o, const double fac) {
     tmp->fac() *= fac;
     rdm_.push_back(tmp);
   }
-  // then simplify
-  list<list<shared_ptr<RDM>>::iterator> rm;
+  // then simplify. Only RDMs with the same shape can be identical; those without one are compared with all the others.
+  vector<list<shared_ptr<RDM>>::iterator> position;
+  vector<string> shape;
+  unordered_map<string, vector<size_t>> bucket;
   for (auto i = rdm_.begin(); i != rdm_.end(); ++i) {
-    auto j = i; ++j;
-    for ( ; j != rdm_.end(); ++j) {
+    shape.push_back((*i)->shape());
+    bucket[shape.back()].push_back(position.size());
+    position.push_back(i);
+  }
+  list<list<shared_ptr<RDM>>::iterator> rm;
+  for (size_t n = 0; n != position.size(); ++n) {
+    auto i = position[n];
+    auto check = [&](const size_t m) {
+      auto j = position[m];
       if ((*i)->identical(*j)) {
         (*i)->fac() += (*j)->fac();
         rm.push_back(j);
       }
+    };
+    if (shape[n].empty()) {
+      for (size_t m = n+1; m != position.size(); ++m) check(m);
+    } else {
+      for (auto& m : bucket[shape[n]])
+        if (m > n) check(m);
     }
   }
   for (auto& i : rm) rdm_.erase(i);
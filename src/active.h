@@ -38,6 +38,27 @@
 
 namespace smith {
 
+/// Reduced RDMs of an Active object in terms of the positions of its indices and spins, so that they can be reused for relabeled indices.
+struct ActivePattern {
+  /// Label, number and dagger of indices. When input is not negative, the core of the index at that position is shared and the rest is not used.
+  struct Core { int input; int space; int num; bool dagger; };
+  /// Index objects in the order of construction. When input is not negative, this is the index at that position.
+  struct Slot { int input; int core; int spin; };
+  /// An RDM with indices and delta functions given as slots.
+  struct Term { bool derived; double fac; bool bra; bool ket; std::vector<int> index; std::vector<std::pair<int,int>> delta; };
+
+  std::vector<Core> core;
+  std::vector<Slot> slot;
+  std::vector<Term> rdm;
+  /// Map from ket reindexing, in positions.
+  std::map<int, int> num_map;
+
+  /// Returns this pattern as text (see DiskCache).
+  std::string str() const;
+  /// Reads a pattern written by str(). Returns false if the text is broken.
+  bool read(const std::string& in);
+};
+
 /// A class for active tensors.
 class Active {
   protected:
@@ -57,10 +78,19 @@ class Active {
     /// Map from ket reindexing.
     std::map<int, int> num_map_;
 
+    /// Returns a key that is the same for lists of indices that reduce to the same RDMs up to relabeling.
+    static std::string key(const std::list<std::shared_ptr<const Index>>& in, std::pair<bool, bool> braket);
+    /// Records the RDMs as a pattern of given indices. Returns nullptr when they cannot be relabeled.
+    std::shared_ptr<const ActivePattern> pattern(const std::list<std::shared_ptr<const Index>>& in) const;
+    /// Makes the RDMs from a pattern for given indices.
+    void apply(const ActivePattern& p, const std::list<std::shared_ptr<const Index>>& in);
 
   public:
     /// Make active object from const list index and braket.
     Active(const std::list<std::shared_ptr<const Index>>& in, std::pair<bool, bool> braket);
+    /// Make active object from RDMs that are already reduced (see Snapshot).
+    Active(const std::list<std::shared_ptr<RDM>>& rdm, std::pair<bool, bool> braket, const std::map<int, int>& num_map)
+      : rdm_(rdm), bra_(braket.first), ket_(braket.second), num_map_(num_map) { }
     ~Active() { }
 
     /// Prints active tensor prefactor, indices and delta (equivalent indices).
@@ -75,14 +105,16 @@ class Active {
     bool operator==(const Active& o) const;
 
     /// This generate does get_block, sort_indices, and the merged (fock) multiplication for Gamma summation.
-    std::string generate(const std::string indent, const std::string tag, const std::list<std::shared_ptr<const Index>> index, const std::list<std::shared_ptr<const Index>> merged = std::list<std::shared_ptr<const Index>>(), const std::string mlab = "", const bool use_blas = false) const;
-    std::string generate_sources(const std::string indent, const std::string tag, const std::list<std::shared_ptr<const Index>> index, const std::list<std::shared_ptr<const Index>> merged = std::list<std::shared_ptr<const Index>>(), const std::string mlab = "", const bool use_blas = false) const;
+    std::string generate(const std::string indent, const std::string tag, const std::list<std::shared_ptr<const Index>> index, const std::list<std::shared_ptr<const Index>> merged = std::list<std::shared_ptr<const Index>>(), const std::vector<std::string>& mlab = std::vector<std::string>(), const bool use_blas = false) const;
+    std::string generate_sources(const std::string indent, const std::string tag, const std::list<std::shared_ptr<const Index>> index, const std::list<std::shared_ptr<const Index>> merged = std::list<std::shared_ptr<const Index>>(), const std::vector<std::string>& mlab = std::vector<std::string>(), const bool use_blas = false) const;
     /// Returns vector of int cooresponding to RDM numbers in Gamma. RDM0 is not included for non derivative trees.
     std::vector<std::string> required_rdm(const bool merged = false) const;
 
 
     /// Map from ket reindexing.
     std::map<int, int> num_map() const { return num_map_; }
+    /// Returns the bra and ket.
+    std::pair<bool, bool> braket() const { return std::make_pair(bra_, ket_); }
 
     /// Merge two Active's
     void merge(std::shared_ptr<const Active> o, const double fac);
@@ -0,0 +1,50 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: arena.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <stdexcept>
+#include "arena.h"
+
+using namespace std;
+using namespace smith;
+
+
+shared_ptr<Arena>& Arena::current_() {
+  static shared_ptr<Arena> current;
+  return current;
+}
+
+
+void* Arena::allocate(const size_t n, const size_t align) {
+  if (n > chunk_size) throw logic_error("too large an object in Arena::allocate");
+  lock_guard<mutex> lock(mutex_);
+  size_t offset = (used_ + align - 1) / align * align;
+  if (offset + n > chunk_size) {
+    chunk_.emplace_back(new char[chunk_size]);
+    offset = 0;
+  }
+  used_ = offset + n;
+  return chunk_.back().get() + offset;
+}
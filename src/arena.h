@@ -0,0 +1,107 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: arena.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace smith {
+
+/// Memory arena from which objects created while building one Equation are bump-allocated. Objects never return memory individually;
+/// everything is released at once when the arena is destroyed, which happens after the last object allocated from it is gone.
+class Arena {
+  protected:
+    /// Size of each chunk of memory in bytes.
+    static const size_t chunk_size = 1 << 20;
+    /// Chunks of memory. Objects are allocated from the last one.
+    std::vector<std::unique_ptr<char[]>> chunk_;
+    /// Number of bytes used in the last chunk.
+    size_t used_;
+    /// Protects the above.
+    std::mutex mutex_;
+
+    /// The arena currently in use.
+    static std::shared_ptr<Arena>& current_();
+
+  public:
+    Arena() : used_(chunk_size) { }
+
+    /// Returns a memory block of n bytes aligned to align. Thread safe.
+    void* allocate(const size_t n, const size_t align);
+
+    /// Returns the arena currently in use; null if objects are allocated from the heap.
+    static std::shared_ptr<Arena> current() { return current_(); }
+
+    /// Makes an arena the current one during the lifetime of this object. Should not be created while other threads allocate objects.
+    class Scope {
+      protected:
+        /// The arena previously in use.
+        std::shared_ptr<Arena> prev_;
+      public:
+        Scope(std::shared_ptr<Arena> a) : prev_(current_()) { current_() = a; }
+        ~Scope() { current_() = prev_; }
+    };
+};
+
+
+/// Allocator that takes memory from an arena. Copies of this allocator in shared_ptr control blocks keep the arena alive.
+template<typename T>
+class ArenaAllocator {
+  protected:
+    template<typename U> friend class ArenaAllocator;
+    /// The arena.
+    std::shared_ptr<Arena> arena_;
+
+  public:
+    typedef T value_type;
+
+    ArenaAllocator(std::shared_ptr<Arena> a) : arena_(a) { }
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& o) : arena_(o.arena_) { }
+
+    T* allocate(const size_t n) { return static_cast<T*>(arena_->allocate(n*sizeof(T), alignof(T))); }
+    /// Memory is released with the arena.
+    void deallocate(T*, const size_t) { }
+
+    template<typename U> bool operator==(const ArenaAllocator<U>& o) const { return arena_ == o.arena_; }
+    template<typename U> bool operator!=(const ArenaAllocator<U>& o) const { return arena_ != o.arena_; }
+};
+
+
+/// Creates an object as make_shared does, taking memory from the current arena if any (see Arena::Scope).
+template<typename T, typename... Args>
+std::shared_ptr<T> arena_shared(Args&&... args) {
+  std::shared_ptr<Arena> a = Arena::current();
+  if (!a) return std::make_shared<T>(std::forward<Args>(args)...);
+  return std::allocate_shared<T>(ArenaAllocator<T>(a), std::forward<Args>(args)...);
+}
+
+}
+
+#endif
@@ -153,6 +153,9 @@ int count_distinct_tensors__(const std::vector<std::string>& labels) {
 //#define _MRCI
 //#define _RELCASPT2
 //#define _RELMRCI
+// Wick's expansion is done one contraction path at a time so that memory is bounded by the length of the operator string.
+// Comment out to expand all the diagrams level by level.
+#define _WICK_DEPTH_FIRST
 #if defined(_CASPT2) || defined(_MRCI)
 static const std::string DataType = "double";
 #elif defined(_RELCASPT2) || defined(_RELMRCI)
@@ -160,6 +163,17 @@ static const std::string DataType = "std::complex<double>";
 #else
 static_assert(false, "Please compile using make.sh");
 #endif
+// 4-RDMs of the reference are rebuilt from rdm1-rdm3 by their cumulant expansion, neglecting the four-body cumulant,
+// so that the generated Gamma tasks neither read nor store rdm4 and rdm4f. Set per theory to compare with the exact variant.
+#if defined(_CASPT2)
+static const bool CumulantRDM4 = false;
+#elif defined(_MRCI)
+static const bool CumulantRDM4 = false;
+#elif defined(_RELCASPT2)
+static const bool CumulantRDM4 = false;
+#elif defined(_RELMRCI)
+static const bool CumulantRDM4 = false;
+#endif
 static const double fac2 = (DataType == "double" ? 2.0 : 1.0);
 static const std::string GEMM = (DataType == "double" ? "dgemm_" : "zgemm3m_");
 static const std::string SCAL = (DataType == "double" ? "dscal_" : "zscal_");
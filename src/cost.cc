@@ -32,9 +32,9 @@ using namespace smith;
 
 string PCost::show() const {
   stringstream out;
-  auto j = pcost_.begin();
-  for (auto i = indmap_.begin(); i != indmap_.end(); ++i, ++j)
-    out << i->first <<  *j;
+  for (auto& i : IndexMap::get())
+    if (i.range >= 0)
+      out << i.label << pcost_[i.range];
   return out.str();
 }
 
@@ -38,14 +38,12 @@ class PCost {
   protected:
     /// a vector of integers with length cat
     std::vector<int> pcost_;
-    /// mapping information. Maybe this is not the most beautiful way..
-    IndexMap indmap_;
 
   public:
     /// Construct pcost from pcst vector.
     PCost(const std::vector<int>& pcst): pcost_(pcst) { }
     /// resize mappping.
-    PCost() { pcost_.resize(indmap_.size()); }
+    PCost() { pcost_.resize(IndexMap::get().num_range()); }
     ~PCost() { }
 
     /// return true if total cost is less than other total cost.
@@ -60,10 +58,10 @@ class PCost {
     /// Give total seconds.
     double pcost_total() const {
       double out = 0.0;
-      assert(pcost_.size() == indmap_.size());
-      auto j = indmap_.begin();
-      for (auto i = pcost_.begin(); i != pcost_.end(); ++i, ++j)
-        out += std::log(static_cast<double>(j->second.second))* *i;
+      assert(static_cast<int>(pcost_.size()) == IndexMap::get().num_range());
+      for (auto& j : IndexMap::get())
+        if (j.range >= 0)
+          out += std::log(static_cast<double>(j.size)) * pcost_[j.range];
       return out;
     }
     /// Return pcost.
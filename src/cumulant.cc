@@ -0,0 +1,233 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: cumulant.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <sstream>
+#include "cumulant.h"
+#include "constants.h"
+
+using namespace std;
+using namespace smith;
+
+
+Cumulant::Cumulant(const int rank, const bool spinfree) : rank_(rank) {
+  auto cycles = [](const vector<int>& perm) {
+    int out = 0;
+    vector<bool> seen(perm.size(), false);
+    for (int i = 0; i != perm.size(); ++i) {
+      if (seen[i]) continue;
+      ++out;
+      for (int j = i; !seen[j]; j = perm[j]) seen[j] = true;
+    }
+    return out;
+  };
+
+  // partitions of the slots into at least two cumulants, given as the cumulant of each slot (restricted growth strings)
+  vector<vector<int>> partition;
+  vector<int> block(rank, 0);
+  function<void(int,int)> grow = [&](const int n, const int nblock) {
+    if (n == rank) {
+      if (nblock > 1) partition.push_back(block);
+      return;
+    }
+    for (int i = 0; i <= nblock; ++i) {
+      block[n] = i;
+      grow(n+1, max(nblock, i+1));
+    }
+  };
+  grow(1, 1);
+
+  for (auto& b : partition) {
+    const int nblock = *max_element(b.begin(), b.end()) + 1;
+    // terms are grouped by the cumulant that the second operator of each slot belongs to. The first operator of slot i is paired with the second one of slot perm[i].
+    vector<vector<int>> lower;
+    vector<vector<vector<int>>> perms;
+    vector<int> perm(rank);
+    iota(perm.begin(), perm.end(), 0);
+    do {
+      vector<int> l(rank);
+      for (int i = 0; i != rank; ++i) l[perm[i]] = b[i];
+      auto iter = find(lower.begin(), lower.end(), l);
+      if (iter == lower.end()) {
+        lower.push_back(l);
+        perms.push_back({perm});
+      } else {
+        perms[iter-lower.begin()].push_back(perm);
+      }
+    } while (next_permutation(perm.begin(), perm.end()));
+
+    for (int g = 0; g != lower.size(); ++g) {
+      int best = 0;
+      for (auto& p : perms[g]) best = max(best, cycles(p));
+      // in spin-free expansions, a product of two 2-cumulants that exchange both slots takes both pairings with factors that are not powers of -1/2
+      const bool exchange = spinfree && rank == 4 && nblock == 2 && count(b.begin(), b.end(), 0) == 2
+                         && equal(b.begin(), b.end(), lower[g].begin(), [](const int i, const int j) { return i != j; });
+      for (auto& p : perms[g]) {
+        const int c = cycles(p);
+        Term t;
+        if (exchange) {
+          t.num = 1;
+          t.den = c == 2 ? 3 : 6;
+        } else if (c == best) {
+          t.num = (rank - c) % 2 ? -1 : 1;
+          t.den = spinfree ? 1 << (rank - c) : 1;
+        } else {
+          continue;
+        }
+        for (int k = 0; k != nblock; ++k) {
+          pair<vector<int>, vector<int>> cumulant;
+          for (int i = 0; i != rank; ++i)
+            if (b[i] == k) {
+              cumulant.first.push_back(i);
+              cumulant.second.push_back(p[i]);
+            }
+          t.cumulant.push_back(cumulant);
+        }
+        term_.push_back(t);
+        // spin-orbital cumulants are antisymmetric, so a single pairing is taken
+        if (!spinfree) break;
+      }
+    }
+  }
+}
+
+
+string Cumulant::generate_block_class() {
+  stringstream ss;
+  ss << "namespace {" << endl << endl;
+  ss << "// Blocks of the 4-RDM rebuilt from rdm1, rdm2 and rdm3 by the cumulant expansion, neglecting the four-body cumulant." << endl;
+  ss << "// Each term of the expansion of an RDM of rank n is listed as its factor (numerator and denominator), the number of cumulants," << endl;
+  ss << "// and for each cumulant its rank k, followed by k slots for the first operators of its pairs and k slots for the second ones." << endl;
+  ss << "const std::vector<std::vector<int>> cumulant_term = {" << endl;
+  for (int n = 0; n <= 4; ++n) {
+    ss << "  {";
+    if (n > 1) {
+      const Cumulant cumulant(n, DataType == "double");
+      for (auto& t : cumulant.term()) {
+        ss << endl << "    " << t.num << "," << t.den << "," << t.cumulant.size() << ",";
+        for (auto& c : t.cumulant) {
+          ss << " " << c.first.size() << ",";
+          for (auto& i : c.first) ss << i << ",";
+          for (auto& i : c.second) ss << i << ",";
+        }
+      }
+      ss << endl << "  ";
+    }
+    ss << "}" << (n != 4 ? "," : "") << endl;
+  }
+  ss << "};" << endl << endl;
+
+  const string D = DataType;
+  ss << "class CumulantBlock {" << endl;
+  ss << "  protected:" << endl;
+  ss << "    const std::array<std::shared_ptr<const Tensor>,3> rdm_;" << endl;
+  ss << "    // x_[2*i] and x_[2*i+1] are the first and second indices of slot i" << endl;
+  ss << "    const std::array<Index,8> x_;" << endl;
+  ss << "    // cumulants by their slots" << endl;
+  ss << "    std::map<std::vector<int>, std::unique_ptr<" << D << "[]>> lambda_;" << endl << endl;
+
+  ss << "    // adds the expansion of the RDM that pairs the slots first[i] and second[i], multiplied by fac, to data" << endl;
+  ss << "    void expand(const std::vector<int>& first, const std::vector<int>& second, const double fac, " << D << "* data) {" << endl;
+  ss << "      const int n = first.size();" << endl;
+  ss << "      std::vector<size_t> dim(2*n);" << endl;
+  ss << "      for (int i = 0; i != n; ++i) {" << endl;
+  ss << "        dim[2*i] = x_[2*first[i]].size();" << endl;
+  ss << "        dim[2*i+1] = x_[2*second[i]+1].size();" << endl;
+  ss << "      }" << endl;
+  ss << "      const size_t size = std::accumulate(dim.begin(), dim.end(), size_t(1), std::multiplies<size_t>());" << endl;
+  ss << "      for (auto t = cumulant_term[n].begin(); t != cumulant_term[n].end(); ) {" << endl;
+  ss << "        const double f = fac * t[0] / t[1];" << endl;
+  ss << "        const int ncumulant = t[2];" << endl;
+  ss << "        t += 3;" << endl;
+  ss << "        // data of the cumulants, and their strides for each index of data" << endl;
+  ss << "        std::vector<const " << D << "*> cdata;" << endl;
+  ss << "        std::vector<std::vector<size_t>> stride;" << endl;
+  ss << "        for (int c = 0; c != ncumulant; ++c) {" << endl;
+  ss << "          const int k = *t++;" << endl;
+  ss << "          std::vector<int> cfirst, csecond;" << endl;
+  ss << "          std::vector<size_t> s(2*n, 0);" << endl;
+  ss << "          size_t current = 1;" << endl;
+  ss << "          for (int i = 0; i != k; ++i) {" << endl;
+  ss << "            cfirst.push_back(first[t[i]]);" << endl;
+  ss << "            csecond.push_back(second[t[k+i]]);" << endl;
+  ss << "            s[2*t[i]] = current;" << endl;
+  ss << "            current *= dim[2*t[i]];" << endl;
+  ss << "            s[2*t[k+i]+1] = current;" << endl;
+  ss << "            current *= dim[2*t[k+i]+1];" << endl;
+  ss << "          }" << endl;
+  ss << "          t += 2*k;" << endl;
+  ss << "          cdata.push_back(lambda(cfirst, csecond));" << endl;
+  ss << "          stride.push_back(s);" << endl;
+  ss << "        }" << endl;
+  ss << "        std::vector<size_t> e(2*n, 0);" << endl;
+  ss << "        for (size_t j = 0; j != size; ++j) {" << endl;
+  ss << "          " << D << " prod = f;" << endl;
+  ss << "          for (int c = 0; c != ncumulant; ++c)" << endl;
+  ss << "            prod *= cdata[c][std::inner_product(e.begin(), e.end(), stride[c].begin(), size_t(0))];" << endl;
+  ss << "          data[j] += prod;" << endl;
+  ss << "          for (int i = 0; i != 2*n && ++e[i] == dim[i]; ++i)" << endl;
+  ss << "            e[i] = 0;" << endl;
+  ss << "        }" << endl;
+  ss << "      }" << endl;
+  ss << "    }" << endl << endl;
+
+  ss << "    // returns the cumulant that pairs the slots first[i] and second[i]" << endl;
+  ss << "    const " << D << "* lambda(const std::vector<int>& first, const std::vector<int>& second) {" << endl;
+  ss << "      std::vector<int> key = first;" << endl;
+  ss << "      key.insert(key.end(), second.begin(), second.end());" << endl;
+  ss << "      auto iter = lambda_.find(key);" << endl;
+  ss << "      if (iter != lambda_.end())" << endl;
+  ss << "        return iter->second.get();" << endl;
+  ss << "      std::unique_ptr<" << D << "[]> data;" << endl;
+  ss << "      if (first.size() == 1) {" << endl;
+  ss << "        data = rdm_[0]->get_block(x_[2*first[0]], x_[2*second[0]+1]);" << endl;
+  ss << "      } else if (first.size() == 2) {" << endl;
+  ss << "        data = rdm_[1]->get_block(x_[2*first[0]], x_[2*second[0]+1], x_[2*first[1]], x_[2*second[1]+1]);" << endl;
+  ss << "        expand(first, second, -1.0, data.get());" << endl;
+  ss << "      } else {" << endl;
+  ss << "        data = rdm_[2]->get_block(x_[2*first[0]], x_[2*second[0]+1], x_[2*first[1]], x_[2*second[1]+1], x_[2*first[2]], x_[2*second[2]+1]);" << endl;
+  ss << "        expand(first, second, -1.0, data.get());" << endl;
+  ss << "      }" << endl;
+  ss << "      return (lambda_[key] = std::move(data)).get();" << endl;
+  ss << "    }" << endl << endl;
+
+  ss << "  public:" << endl;
+  ss << "    CumulantBlock(const std::array<std::shared_ptr<const Tensor>,3>& rdm, const std::array<Index,8>& x) : rdm_(rdm), x_(x) { }" << endl << endl;
+  ss << "    std::unique_ptr<" << D << "[]> get_block() {" << endl;
+  ss << "      size_t size = 1;" << endl;
+  ss << "      for (auto& i : x_)" << endl;
+  ss << "        size *= i.size();" << endl;
+  ss << "      std::unique_ptr<" << D << "[]> out(new " << D << "[size]);" << endl;
+  ss << "      std::fill_n(out.get(), size, 0.0);" << endl;
+  ss << "      expand({0,1,2,3}, {0,1,2,3}, 1.0, out.get());" << endl;
+  ss << "      return out;" << endl;
+  ss << "    }" << endl;
+  ss << "};" << endl << endl;
+  ss << "}" << endl << endl;
+  return ss.str();
+}
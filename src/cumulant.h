@@ -0,0 +1,66 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: cumulant.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __CUMULANT_H
+#define __CUMULANT_H
+
+#include <vector>
+#include <string>
+
+namespace smith {
+
+/// Cumulant expansion of an RDM of the reference in terms of the cumulants of lower ranks. The pairs of operators of the RDM are called slots.
+/// The expansion is spin-free (exact for singlet references when the cumulant of the same rank is added) or, for relativistic theories, spin-orbital.
+/// Used to rebuild 4-RDMs from rdm1-rdm3 in the generated code; see CumulantRDM4 in constants.h.
+class Cumulant {
+  public:
+    /// A product of cumulants with a factor num/den. Cumulant i pairs the first operator of slot cumulant[i].first[j] with the second one of slot cumulant[i].second[j].
+    struct Term {
+      int num;
+      int den;
+      std::vector<std::pair<std::vector<int>, std::vector<int>>> cumulant;
+    };
+
+  protected:
+    /// Rank of the RDM.
+    int rank_;
+    /// Terms of the expansion, without the cumulant of rank rank_.
+    std::vector<Term> term_;
+
+  public:
+    /// Enumerates the terms of the expansion of an RDM of the given rank.
+    Cumulant(const int rank, const bool spinfree);
+
+    /// Returns the terms.
+    const std::vector<Term>& term() const { return term_; }
+
+    /// Returns the definition of the class that computes blocks of 4-RDMs in the generated tasks (CumulantBlock).
+    static std::string generate_block_class();
+};
+
+}
+
+#endif
@@ -24,68 +24,56 @@
 
 
 #include <iomanip>
+#include <map>
 #include <algorithm>
-#include "diagram.h"
+#include <functional>
+#include <unordered_map>
+#include "flatdiagram.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
 list<shared_ptr<Diagram>> Diagram::get_all() const {
-  list<shared_ptr<Diagram>> out;
+  // General indices are turned into active ones in the Gray-code order on a working copy, so that one index changes at a time and the balance
+  // of active daggered and non-daggered indices is updated incrementally. Only the consistent assignments are copied.
+  shared_ptr<Diagram> work = copy();
+  vector<tuple<shared_ptr<Index>*,int,int>*> general;
+  int balance = 0;
+  for (auto& i : work->op()) {
+    for (auto& j : i->op())
+      if ((*get<0>(j))->space() == IndexMap::general) general.push_back(&j);
+    balance += i->num_active_dagger() - i->num_active_nodagger();
+  }
 
-  const int max = 1 << num_general();
-  for (int i = 0; i != max; ++i) {
-    int j = i;
-    shared_ptr<Diagram> d = copy();
-    for (auto& k : d->op()) k->mutate_general(j);
-    if (d->consistent_indices()) {
-      out.push_back(d);
-    }
+  // keyed by the bits of Operator::mutate_general, which determine the order of the output
+  map<int, shared_ptr<Diagram>> found;
+  const int max = 1 << general.size();
+  for (int i = 0, gray = 0; ; ) {
+    if (balance == 0) found.emplace(gray, work->copy());
+    if (++i == max) break;
+    // the k-th bit changes
+    int k = 0;
+    while (!((i >> k) & 1)) ++k;
+    gray ^= 1 << k;
+    const bool on = (gray >> k) & 1;
+    tuple<shared_ptr<Index>*,int,int>& g = *general[k];
+    (*get<0>(g))->set_space(on ? IndexMap::active : IndexMap::general);
+    get<1>(g) += on ? 2 : -2;
+    balance += ((*get<0>(g))->dagger() ? 1 : -1) * (on ? 1 : -1);
   }
+
+  Stats::get().add("wick", "general_assignments", max);
+  Stats::get().add("wick", "roots", found.size());
+
+  list<shared_ptr<Diagram>> out;
+  for (auto& i : found) out.push_back(i.second);
   return out;
 }
 
 // copying diagram with the same connectivity and so on.
 shared_ptr<Diagram> Diagram::copy() const {
-  // mapping of indices and spins. map<old, new>
-  map<shared_ptr<Index>, shared_ptr<Index>> indexmap;
-  map<shared_ptr<Spin>, shared_ptr<Spin>> spinmap;
-
-  // creates Diagram without any info
-  shared_ptr<Diagram> out = make_shared<Diagram>();
-  list<shared_ptr<Operator>> outop;
-
-  // loop over operators
-  for (auto& it : op()) {
-    // cloning...
-    shared_ptr<Operator> a = it->copy();
-
-    auto j = a->op().begin();
-    for (auto i = it->op().begin(); i != it->op().end(); ++i, ++j) {
-      auto s = indexmap.find(*get<0>(*i));
-      if (s == indexmap.end()) {
-        indexmap.emplace(*get<0>(*i), *get<0>(*j));
-      } else {
-        *get<0>(*j) = s->second; // one of the operators has s->second...
-      }
-      auto z = spinmap.find(it->rho(get<2>(*i)));
-      if (z == spinmap.end()) {
-        spinmap.emplace(it->rho(get<2>(*i)), a->rho(get<2>(*j)));
-      } else {
-        a->set_rho(get<2>(*j), z->second); // one of the operators has z->second...
-      }
-      get<1>(*j) = get<1>(*i);
-    }
-    outop.push_back(a);
-  }
-  out->set_op(outop);
-  out->set_fac(fac_);
-  out->scalar_ = scalar_;
-  if (dagger_) out->add_dagger();
-  if (bra_) out->set_bra(true);
-  if (ket_) out->set_ket(true);
-  if (absorbed_) out->set_absorbed(true);
-  return out;
+  return FlatDiagram(*this).diagram();
 }
 
 
@@ -102,7 +90,7 @@ list<shared_ptr<const Index>> Diagram::target_index() const {
   }
   // ci derivative tensors also have target indices.
   if (bra_ || ket_) {
-    shared_ptr<const Index> ci = make_shared<Index>("ci",false);
+    shared_ptr<const Index> ci = arena_shared<Index>("ci",false);
     out.push_back(ci);
   }
   return out;
@@ -124,20 +112,52 @@ bool Diagram::has_target_index() const {
 
 
 void Diagram::refresh_indices(list<shared_ptr<const Index>> target) {
-  map<shared_ptr<const Index>, int> dict;
-  map<shared_ptr<const Index>, int> done;
-  map<shared_ptr<Spin>, int> spin;
-
-  // first register target indices in the map
-  for (auto& i : target) {
-    if (i->num() >= 0)
-      dict.emplace(i, i->num());
-    else
-      done.emplace(i, i->num());
+  vector<pair<const Index*, int>> tgt;
+  for (auto& i : target) tgt.push_back(make_pair(i.get(), i->num()));
+
+  // The numbering is sequential, so that operators are renumbered from the first one that has changed since the last call.
+  // Operators before it are only registered. Numbers and spins set by the last call are checked as well.
+  vector<int> opbegin;
+  vector<RefreshedSlot> cur;
+  for (auto& i : op_) {
+    opbegin.push_back(cur.size());
+    for (auto& j : i->op())
+      cur.push_back({get<0>(j)->get(), i->rho(get<2>(j)).get(), get<1>(j), 0, nullptr, 0});
+  }
+  size_t changed = 0;
+  if (tgt == refreshed_target_ && !refreshed_.empty()) {
+    for (; changed != cur.size() && changed != refreshed_.size(); ++changed) {
+      const RefreshedSlot& r = refreshed_[changed];
+      const RefreshedSlot& c = cur[changed];
+      if (c.index != r.index || c.rho != r.rho || c.state != r.state || r.index->num() != r.num
+       || r.index->spin().get() != r.spin || r.rho->num() != r.spin_num) break;
+    }
+    if (changed == cur.size() && changed == refreshed_.size()) return;
   }
+  const size_t first = upper_bound(opbegin.begin(), opbegin.end(), changed) - opbegin.begin() - 1;
 
+  vector<pair<const Index*, int>> dict;
+  vector<pair<const Index*, int>> done;
+  vector<const Spin*> spin;
+
+  // first register target indices
+  for (auto& i : tgt) {
+    vector<pair<const Index*, int>>& v = i.second >= 0 ? dict : done;
+    if (find_if(v.begin(), v.end(), [&i](const pair<const Index*, int>& p) { return p.first == i.first; }) == v.end())
+      v.push_back(i);
+  }
+
+  size_t n = 0;
   for (auto& i : op_)
-    i->refresh_indices(dict, done, spin);
+    i->refresh_indices(dict, done, spin, n++ >= first);
+
+  for (auto& i : cur) {
+    i.num = i.index->num();
+    i.spin = i.index->spin().get();
+    i.spin_num = i.rho->num();
+  }
+  refreshed_ = cur;
+  refreshed_target_ = tgt;
 }
 
 
@@ -231,56 +251,6 @@ void Diagram::print() const {
 }
 
 
-bool Diagram::reduce_one_noactive(const int skip) {
-  refresh_indices();
-
-  bool found = false;
-  // find the first dagger operator in list<Op>
-  auto i = op_.begin();
-  pair<shared_ptr<Index>*, shared_ptr<Spin>* > data; // safe because they are held by tensors
-  for (; i != op_.end(); ++i) {
-    // this simultaneously eliminates one entry. op_ is therefore modified here
-    data = (*i)->first_dagger_noactive();
-    if (data.first) break;
-  }
-  if (!data.first) return false;
-
-  // skip until it comes to skip
-  int cnt = 0;
-  shared_ptr<Spin> newspin, oldspin;
-  bool closed = false;
-  for (auto j = op_.begin(); j != op_.end(); ++j) {
-    // cannot contract with self
-    if (i == j) {
-      closed = true;
-      continue;
-    }
-    // all possible contraction pattern taken for *j (returned as a list).
-    if (cnt + (*j)->num_nodagger() > skip) {
-      tuple<double,shared_ptr<Spin>,shared_ptr<Spin>> tmp = (*j)->contract(data, skip-cnt);
-      if ((closed && (*data.first)->label() == "c") || (!closed && (*data.first)->label() == "a")) {
-        fac_ *= get<0>(tmp);
-        newspin = get<1>(tmp);
-        oldspin = get<2>(tmp);
-        found = true;
-      }
-      break;
-    } else {
-      cnt += (*j)->num_nodagger();
-    }
-  }
-  if (found) {
-    // if oldspin is restricted to alpha spin, we have to pass along that information
-    if (oldspin->alpha())
-      newspin->set_alpha(oldspin->alpha());
-    for (auto& j : op_)
-      for (auto& k : j->rho())
-        if (k == oldspin) k = newspin;
-  }
-  return found;
-}
-
-
 bool Diagram::valid() const {
   int out = 0;
   for (auto& i : op_) {
@@ -375,6 +345,140 @@ bool Diagram::permute(const bool proj) {
 }
 
 
+vector<vector<string>> Diagram::pair_keys() const {
+  // where each index object appears: operator and whether it is the first or second of a pair
+  unordered_map<const Index*, vector<pair<int,int>>> where;
+  int k = 0;
+  for (auto& i : op_) {
+    int r = 0;
+    for (auto& j : i->op())
+      where[get<0>(j)->get()].push_back(make_pair(k, r++ & 1));
+    ++k;
+  }
+  vector<vector<string>> out;
+  k = 0;
+  for (auto& i : op_) {
+    vector<string> keys;
+    stringstream ss;
+    int r = 0;
+    for (auto& j : i->op()) {
+      const Index* index = get<0>(j)->get();
+      ss << get<1>(j) << index->label() << "{";
+      vector<pair<int,int>> partner;
+      for (auto& w : where[index])
+        if (w != make_pair(k, r & 1)) partner.push_back(w);
+      sort(partner.begin(), partner.end());
+      for (auto& w : partner) ss << w.first << "." << w.second << " ";
+      ss << "}";
+      if (r++ & 1) {
+        keys.push_back(ss.str());
+        ss.str("");
+      }
+    }
+    keys.resize(i->perm().size());
+    out.push_back(keys);
+    ++k;
+  }
+  return out;
+}
+
+
+string Diagram::orbit_key() const {
+  stringstream ss;
+  auto keys = pair_keys();
+  auto k = keys.begin();
+  for (auto& i : op_) {
+    sort(k->begin(), k->end());
+    ss << i->label() << "(";
+    for (auto& j : *k++) ss << j << " ";
+    ss << ")";
+  }
+  ss << bra_ << ket_;
+  return ss.str();
+}
+
+
+vector<vector<int>> Diagram::arrangement(const Diagram& o, const bool proj, long& count) {
+  const vector<vector<string>> mine = pair_keys();
+  const vector<vector<string>> theirs = o.pair_keys();
+  if (mine.size() != theirs.size()) return vector<vector<int>>();
+
+  // permutation counts of each operator that map pairs onto those with the same key, in lexicographical order (as in next_permutation)
+  vector<vector<vector<int>>> candidates;
+  vector<vector<int>> start;
+  auto k = mine.begin();
+  auto l = theirs.begin();
+  for (auto i = op_.begin(); i != op_.end(); ++i, ++k, ++l) {
+    const vector<int>& perm = (*i)->perm();
+    start.push_back(perm);
+    if (k->size() != l->size()) return vector<vector<int>>();
+    const int size = perm.size();
+    // key of each original pair
+    vector<string> key(size);
+    for (int p = 0; p != size; ++p) key[perm[p]] = (*k)[p];
+
+    vector<vector<int>> cand;
+    if (!(*i)->permutable(proj)) {
+      if (*k == *l) cand.push_back(perm);
+    } else {
+      vector<int> current;
+      vector<bool> used(size, false);
+      function<void()> fill = [&]() {
+        const int q = current.size();
+        if (q == size) {
+          cand.push_back(current);
+          return;
+        }
+        for (int p = 0; p != size; ++p) {
+          if (used[p] || key[p] != (*l)[q]) continue;
+          used[p] = true;
+          current.push_back(p);
+          fill();
+          current.pop_back();
+          used[p] = false;
+        }
+      };
+      fill();
+    }
+    if (cand.empty()) return vector<vector<int>>();
+    candidates.push_back(cand);
+  }
+
+  // the last operator runs fastest as in permute
+  const string target = o.signature();
+  vector<vector<int>> out;
+  vector<size_t> c(candidates.size(), 0);
+  vector<vector<int>> perm(candidates.size());
+  while (true) {
+    for (size_t n = 0; n != c.size(); ++n) perm[n] = candidates[n][c[n]];
+    arrange(perm);
+    ++count;
+    if (signature() == target) {
+      out = perm;
+      break;
+    }
+    int n = c.size() - 1;
+    for ( ; n >= 0; --n) {
+      if (++c[n] != candidates[n].size()) break;
+      c[n] = 0;
+    }
+    if (n < 0) break;
+  }
+  arrange(start);
+  return out;
+}
+
+
+void Diagram::arrange(const vector<vector<int>>& perm) {
+  auto p = perm.begin();
+  for (auto& i : op_) {
+    if (i->perm() != *p) fac_ *= i->arrange(*p);
+    ++p;
+  }
+  refresh_indices();
+}
+
+
 bool Diagram::identical(shared_ptr<Diagram> o) const {
 
   bool out = true;
@@ -425,4 +529,39 @@ bool Diagram::identical(shared_ptr<Diagram> o) const {
 }
 
 
+string Diagram::shape() const {
+  stringstream ss;
+  for (auto& i : op_) {
+    ss << i->label() << "(";
+    for (auto& j : i->op()) {
+      shared_ptr<const Index> index = *get<0>(j);
+      ss << get<1>(j) << index->label() << index->num() << (index->has_spin() && index->spin()->alpha() ? "*" : "") << " ";
+    }
+    ss << ")";
+  }
+  ss << bra_ << ket_;
+  return ss.str();
+}
+
 
+string Diagram::signature() const {
+  stringstream ss;
+  for (auto& i : op_) {
+    ss << i->label() << "(";
+    for (auto& j : i->op()) {
+      shared_ptr<const Index> index = *get<0>(j);
+      ss << get<1>(j) << index->str(false) << " ";
+    }
+    ss << ")";
+  }
+  // active spins numbered in the order of appearance
+  vector<shared_ptr<const Spin>> spin;
+  ss << "[";
+  for (auto& i : active_indices()) {
+    auto iter = find(spin.begin(), spin.end(), i->spin());
+    ss << (iter - spin.begin()) << " ";
+    if (iter == spin.end()) spin.push_back(i->spin());
+  }
+  ss << "]" << bra_ << ket_;
+  return ss.str();
+}
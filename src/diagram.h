@@ -55,6 +55,19 @@ class Diagram {
     /// If this Diagram has a daggered counterpart (often the case for residual equations).
     bool dagger_;
 
+    /// An index slot of an operator as left by the last refresh_indices.
+    struct RefreshedSlot {
+      const Index* index;
+      const Spin* rho;
+      int state;
+      int num;
+      const Spin* spin;
+      int spin_num;
+    };
+    /// Index slots as left by the last refresh_indices, used to find the operators that have changed since then.
+    std::vector<RefreshedSlot> refreshed_;
+    /// Target indices and their numbers given to the last refresh_indices.
+    std::vector<std::pair<const Index*, int>> refreshed_target_;
 
 
   public:
@@ -83,6 +96,8 @@ class Diagram {
     const std::list<std::shared_ptr<Operator>>& op() const { return op_; }
     /// Return scalar name reference.
     std::string& scalar() { return scalar_; }
+    /// Return const scalar name reference.
+    const std::string& scalar() const { return scalar_; }
     /// Returns rdm pointer.
     std::shared_ptr<Active> rdm() { return rdm_; }
     /// If diagram is transposed.
@@ -106,6 +121,8 @@ class Diagram {
     void set_ket(bool b) { ket_ = b; }
     /// Set absorbed for ket case.
     void set_absorbed(bool b) { absorbed_ = b; }
+    /// Set the active part, which is otherwise made by active().
+    void set_rdm(std::shared_ptr<Active> a) { rdm_ = a; }
 
 
     /// Refresh the indices for each operator in diagram (ie calls operators refresh_indices function).
@@ -127,6 +144,19 @@ class Diagram {
     bool permute(const bool proj);
     /// If diagrams are same, based on size, indices, spin, bra and ket.
     bool identical(std::shared_ptr<Diagram> o) const;
+    /// Returns a string that is the same for identical() diagrams (spins are not compared), used as a hash key.
+    std::string shape() const;
+    /// Returns a string that is the same for two diagrams if and only if they are identical(). Used as a hash key; indices should be refreshed.
+    std::string signature() const;
+    /// Returns a key for each pair of indices in each operator (see Operator::perm()) that is not changed by permute.
+    std::vector<std::vector<std::string>> pair_keys() const;
+    /// Returns a string that is the same for two diagrams if permute can make them identical() (but not only then).
+    std::string orbit_key() const;
+    /// Returns the first permutation counts in the order of permute that make this diagram identical to o, or an empty vector if there are none.
+    /// Only the permutations that map pairs onto pairs with the same key are tried, and the diagram is left unchanged.
+    std::vector<std::vector<int>> arrangement(const Diagram& o, const bool proj, long& count);
+    /// Permutes indices in operators to given permutation counts and refreshes the indices.
+    void arrange(const std::vector<std::vector<int>>& perm);
 
     /// checks if diagram has target indices from excitation operators, or if ci derivative.
     bool has_target_index() const;
@@ -146,9 +176,6 @@ class Diagram {
     /// Returns if this diagram has a consistent set of dagger and undaggered indices.
     bool consistent_indices() const;
 
-    /// This function performs one contraction ** IN PLACE ** called from equation.
-    bool reduce_one_noactive(const int skip);
-
     /// Returns if this diagram is still valid.
     bool valid() const;
     /// Returns if this diagram is fully contracted and sorted.
@@ -0,0 +1,127 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: diskcache.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "constants.h"
+#include "diskcache.h"
+
+using namespace std;
+using namespace smith;
+
+/// Incremented whenever the format of the entries changes.
+static const int version__ = 1;
+
+
+DiskCache::DiskCache(const string& dir) : dir_(dir) {
+  if (dir_.empty()) return;
+  mkdir(dir_.c_str(), 0755);
+
+  stringstream ss;
+  ss << "smith3 cache " << version__;
+#if defined(_CASPT2)
+  ss << " CASPT2";
+#elif defined(_MRCI)
+  ss << " MRCI";
+#elif defined(_RELCASPT2)
+  ss << " RELCASPT2";
+#elif defined(_RELMRCI)
+  ss << " RELMRCI";
+#endif
+#ifdef _MULTI_DERIV
+  ss << " MULTI_DERIV";
+#endif
+#ifdef _WICK_DEPTH_FIRST
+  ss << " WICK_DEPTH_FIRST";
+#endif
+  ss << " " << DataType << " " << CumulantRDM4 << "\n";
+  switches_ = ss.str();
+}
+
+
+string DiskCache::path(const string& kind, const string& key) const {
+  // 64-bit FNV-1a, which does not depend on the standard library
+  uint64_t hash = 14695981039346656037ull;
+  for (const string* s : {&switches_, &kind, &key})
+    for (const char c : *s) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ull;
+    }
+  stringstream ss;
+  ss << dir_ << "/" << kind << "-" << hex << setw(16) << setfill('0') << hash;
+  return ss.str();
+}
+
+
+bool DiskCache::load(const string& kind, const string& key, string& value) const {
+  if (!enabled()) return false;
+  ifstream fs(path(kind, key), ios::binary);
+  if (!fs) return false;
+  stringstream ss;
+  ss << fs.rdbuf();
+  const string entry = ss.str();
+  // entries start with their full key, which is compared in case of collisions
+  const string head = switches_ + key + "\n";
+  if (entry.compare(0, head.size(), head) != 0) return false;
+  value = entry.substr(head.size());
+  return true;
+}
+
+
+void DiskCache::store(const string& kind, const string& key, const string& value) const {
+  if (!enabled()) return;
+  const string file = path(kind, key);
+  stringstream tmp;
+  tmp << file << ".tmp" << getpid() << "." << hash<thread::id>()(this_thread::get_id());
+  {
+    ofstream fs(tmp.str(), ios::binary);
+    fs << switches_ << key << "\n" << value;
+    if (!fs) {
+      remove(tmp.str().c_str());
+      return;
+    }
+  }
+  if (rename(tmp.str().c_str(), file.c_str()) != 0)
+    remove(tmp.str().c_str());
+}
+
+
+DiskCache& DiskCache::get() {
+  static DiskCache cache([]() {
+    const char* env = getenv("SMITH3_CACHE_DIR");
+    return string(env ? env : "");
+  }());
+  return cache;
+}
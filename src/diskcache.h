@@ -0,0 +1,64 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: diskcache.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+
+#ifndef __DISKCACHE_H
+#define __DISKCACHE_H
+
+#include <string>
+
+namespace smith {
+
+/// Content-addressed cache on disk for the results of Wick's expansion and of the reduction of active parts, so that they are shared by runs.
+/// Enabled by setting SMITH3_CACHE_DIR to a directory. Entries are keyed by their inputs and the theory switches in constants.h.
+class DiskCache {
+  protected:
+    /// Directory of the cache; empty if disabled.
+    std::string dir_;
+    /// Theory switches prepended to all the keys.
+    std::string switches_;
+
+    DiskCache(const std::string& dir);
+
+    /// Returns the file name of an entry.
+    std::string path(const std::string& kind, const std::string& key) const;
+
+  public:
+    /// Returns if the cache is in use.
+    bool enabled() const { return !dir_.empty(); }
+
+    /// Reads the value of an entry. Returns false if not found.
+    bool load(const std::string& kind, const std::string& key, std::string& value) const;
+    /// Writes an entry. Files are renamed into place, so that concurrent runs see either no entry or a complete one.
+    void store(const std::string& kind, const std::string& key, const std::string& value) const;
+
+    /// Returns the cache of the process.
+    static DiskCache& get();
+};
+
+}
+
+#endif
@@ -23,47 +23,82 @@
 //
 
 
+#include <unordered_map>
+#include <unordered_set>
 #include "equation.h"
 #include "constants.h"
+#include "threadpool.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
-Equation::Equation(shared_ptr<Diagram> in, std::string nam) : name_(nam) {
+/// Minimum number of diagrams per thread in Wick's expansion; smaller sets are processed serially.
+static const size_t wick_grain__ = 16;
+/// Minimum number of diagrams per thread in the reduction of active parts.
+static const size_t active_grain__ = 4;
 
-  list<shared_ptr<Diagram>> out = in->get_all();
+Equation::Equation(shared_ptr<Diagram> in, std::string nam) : name_(nam), arena_(make_shared<Arena>()) {
+  Arena::Scope scope(arena_);
+  Stats::Timer timer("wick");
+
+  // Wick's expansion is performed with the compact encoding of diagrams
+  vector<FlatDiagram> out;
+  for (auto& i : in->get_all())
+    out.push_back(FlatDiagram(*i));
+  // so that the counters are reported even when nothing is pruned
+  Stats::get().add("wick", "pruned", 0);
+  Stats::get().add("wick", "dropped", 0);
 
   if (out.size() != 0) {
-    while (out.front()->num_dagger()) {
-      list<shared_ptr<Diagram>> out2;
-      for (auto& j : out) {
-        for (int i = 0; i != j->num_dagger(); ++i) {
-          shared_ptr<Diagram> n = j->copy();
-          bool found = n->reduce_one_noactive(i);
-          if (!found) continue;
-          if (n->valid() || n->done()) {
-            out2.push_back(n);
-            if (n->done_noactive()) {
-              // drop <I|0> terms
-#ifndef _MULTI_DERIV
-              if (n->braket().first || n->braket().second) {
-                if (n->gamma_derivative()) diagram_.push_back(n);
-              } else {
-                diagram_.push_back(n);
-              }
-#else
-              diagram_.push_back(n);
+    ThreadPool& pool = ThreadPool::get();
+    while (out.front().num_dagger()) {
+#ifdef _WICK_DEPTH_FIRST
+      // expand level by level only until there are enough diagrams to keep all the threads busy
+      if (pool.num_slices(out.size(), wick_grain__) == static_cast<size_t>(pool.size())) break;
 #endif
-            }
+      // each thread reduces a contiguous slice of the current diagrams. Slices are concatenated in order so that the result does not depend on the number of threads.
+      const size_t nslice = pool.num_slices(out.size(), wick_grain__);
+      vector<vector<FlatDiagram>> next(nslice);
+      vector<list<shared_ptr<Diagram>>> done(nslice);
+      pool.parallel_for(out.size(), wick_grain__, [&](const size_t slice, const size_t begin, const size_t end) {
+        for (size_t j = begin; j != end; ++j)
+          for (int i = 0; i != out[j].num_dagger(); ++i) {
+            FlatDiagram n = out[j];
+            if (reduce_one_(n, i, done[slice])) next[slice].push_back(n);
           }
-        }
+      });
+      out.clear();
+      for (size_t i = 0; i != nslice; ++i) {
+        out.insert(out.end(), next[i].begin(), next[i].end());
+        diagram_.splice(diagram_.end(), done[i]);
       }
-      out = out2;
       if (out.size() == 0) break;
     }
+#ifdef _WICK_DEPTH_FIRST
+    // the rest is expanded depth first. Completed diagrams are collected per level and concatenated in the order of the level-by-level
+    // expansion, which stops at the first level whose leading diagram has no daggered operator left.
+    if (out.size() != 0 && out.front().num_dagger()) {
+      const size_t nslice = pool.num_slices(out.size(), wick_grain__);
+      vector<vector<list<shared_ptr<Diagram>>>> done(nslice);
+      vector<vector<int>> first(nslice);
+      pool.parallel_for(out.size(), wick_grain__, [&](const size_t slice, const size_t begin, const size_t end) {
+        for (size_t j = begin; j != end; ++j)
+          expand_(out[j], done[slice], first[slice]);
+      });
+      for (size_t level = 0; ; ++level) {
+        auto lead = find_if(first.begin(), first.end(), [&level](const vector<int>& f) { return f.size() > level; });
+        if (lead == first.end()) break;
+        for (auto& i : done)
+          if (i.size() > level) diagram_.splice(diagram_.end(), i[level]);
+        if ((*lead)[level] == 0) break;
+      }
+    }
+#endif
     // collect target indices from excitation operators.
     for (auto& i : diagram_) i->refresh_indices();
   }
+  Stats::get().add("wick", "diagrams", diagram_.size());
 
   // 4-external contributions are done through optimized code
 #if defined(_RELMRCI) || defined(_MRCI)
@@ -71,20 +106,64 @@ Equation::Equation(shared_ptr<Diagram> in, std::string nam) : name_(nam) {
     bool four = false;
     for (auto& j : (*it)->op()) {
       if (j->op().size() != 4) continue;
-      four |= all_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->label() == "a"; });
+      four |= all_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->space() == IndexMap::virt; });
     }
     for (auto& j : (*it)->op())
-      four &= none_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->label() == "x"; });
+      four &= none_of(j->op().begin(), j->op().end(), [](const tuple<shared_ptr<Index>*,int,int>& o) { return (*get<0>(o))->space() == IndexMap::active; });
 
-    if (four)
+    if (four) {
       it = diagram_.erase(it);
-    else
+      Stats::get().add("wick", "four_external_removed");
+    } else
       ++it;
   }
 #endif
 }
 
 
+bool Equation::reduce_one_(FlatDiagram& n, const int i, list<shared_ptr<Diagram>>& done) const {
+  bool found = n.reduce_one_noactive(i);
+  if (!found) return false;
+  if (n.valid() || n.done()) {
+    if (n.done_noactive()) {
+      if (!dropped_(n)) done.push_back(n.diagram());
+      else Stats::get().add("wick", "dropped");
+    }
+    return true;
+  }
+  return false;
+}
+
+
+bool Equation::dropped_(const FlatDiagram& n) const {
+  // drop <I|0> terms. Active operators are not touched in the expansion, so that this is known before contractions.
+#ifndef _MULTI_DERIV
+  return (n.braket().first || n.braket().second) && !n.gamma_derivative();
+#else
+  return false;
+#endif
+}
+
+
+void Equation::expand_(const FlatDiagram& j, vector<list<shared_ptr<Diagram>>>& done, vector<int>& first) const {
+  shared_ptr<const WickPattern> pattern = j.pattern();
+  // <I|0> terms are not replayed; their pattern is still needed as it tells how deep the expansion goes
+  if (!dropped_(j)) {
+    for (auto& p : pattern->path) {
+      FlatDiagram n = j;
+      for (auto& i : p)
+        if (!n.reduce_one_noactive(i)) throw logic_error("inconsistent contraction path in Equation::expand_");
+      if (done.size() < p.size()) done.resize(p.size());
+      done[p.size()-1].push_back(n.diagram());
+    }
+  } else {
+    Stats::get().add("wick", "dropped", pattern->path.size());
+  }
+  for (size_t l = first.size(); l < pattern->first.size(); ++l)
+    first.push_back(pattern->first[l]);
+}
+
+
 bool Equation::targets() const {
   bool out = false;
   for (auto& i : diagram_) {
@@ -127,10 +206,23 @@ void Equation::print() {
 
 // processes active part
 void Equation::active() {
-  for (auto& i : diagram_) i->active();
+  Arena::Scope scope(arena_);
+  Stats::Timer timer("active");
+  // diagrams are reduced independently. Each Active is stored in its own diagram, so the result does not depend on the number of threads.
+  vector<shared_ptr<Diagram>> diagram(diagram_.begin(), diagram_.end());
+  ThreadPool::get().parallel_for(diagram.size(), active_grain__, [&diagram](const size_t, const size_t begin, const size_t end) {
+    for (size_t j = begin; j != end; ++j)
+      diagram[j]->active();
+  });
+  long nrdm = 0;
+  for (auto& i : diagram_)
+    if (i->rdm()) nrdm += i->rdm()->rdm().size();
+  Stats::get().add("active", "diagrams", diagram_.size());
+  Stats::get().add("active", "rdm_terms", nrdm);
 }
 
 void Equation::reorder_tensors() {
+  Arena::Scope scope(arena_);
   for (auto& i : diagram_) i->reorder_tensors();
 }
 
@@ -140,10 +232,10 @@ void Equation::refresh_indices() {
 
 // find identical terms
 void Equation::duplicates() {
+  Arena::Scope scope(arena_);
+  Stats::Timer timer("duplicates");
   duplicates_(false);
   refresh_indices();
-  // TODO this is only valid for projection up to doubles
-  // For any-order algorithm, we need to use a generic algorithm.
   duplicates_(true);
 }
 
@@ -166,43 +258,72 @@ void Equation::absorb_ket() {
 
 
 void Equation::duplicates_(const bool proj) {
-  list<list<shared_ptr<Diagram>>::iterator> rm;
+  // diagrams are looked up by the signature of their current form. Since permute can only make diagrams identical if they share the
+  // orbit key, only the permutations that map pairs of indices onto those of a later diagram in the same orbit are generated.
+  vector<list<shared_ptr<Diagram>>::iterator> position;
+  vector<string> signature;
+  unordered_map<string, vector<size_t>> table;
+  unordered_map<string, vector<size_t>> orbit;
   for (auto i = diagram_.begin(); i != diagram_.end(); ++i) {
-    bool found = false;
-    // all possible permutations generated here
-    do {
-      // find identical
-      auto j = i;
-      for (++j ; j != diagram_.end(); ++j) {
-        if ((*i)->identical(*j)) {
-          found = true;
-          if (!proj) {
-            (*j)->fac() += (*i)->fac();
-            rm.push_back(i);
-            if ((*j)->fac() == 0) throw logic_error("I don't think that this happens. Check! Equation::factorize1_");
-          } else {
-            (*j)->add_dagger();
-            rm.push_back(i);
-            if ((*j)->fac() != (*i)->fac()) throw logic_error("I don't think that this happens. Check! Equation::factorize2_");
-          }
+    signature.push_back((*i)->signature());
+    table[signature.back()].push_back(position.size());
+    orbit[(*i)->orbit_key()].push_back(position.size());
+    position.push_back(i);
+  }
+
+  list<list<shared_ptr<Diagram>>::iterator> rm;
+  long npermutation = 0;
+  for (auto& o : orbit) {
+    for (auto n = o.second.begin(); n != o.second.end(); ++n) {
+      auto i = position[*n];
+      // the first permutation (in the order of Diagram::permute) that makes it identical to any of the later diagrams
+      vector<vector<int>> first;
+      unordered_set<string> tried;
+      for (auto m = n+1; m != o.second.end(); ++m) {
+        if (!tried.insert(signature[*m]).second) continue;
+        vector<vector<int>> a = (*i)->arrangement(**position[*m], proj, npermutation);
+        if (!a.empty() && (first.empty() || a < first)) first = a;
+      }
+      if (first.empty()) continue;
+      (*i)->arrange(first);
+
+      for (auto& m : table.at((*i)->signature())) {
+        if (m <= *n) continue;
+        auto j = position[m];
+        if (!proj) {
+          (*j)->fac() += (*i)->fac();
+          rm.push_back(i);
+          if ((*j)->fac() == 0) throw logic_error("I don't think that this happens. Check! Equation::factorize1_");
+        } else {
+          (*j)->add_dagger();
+          rm.push_back(i);
+          if ((*j)->fac() != (*i)->fac()) throw logic_error("I don't think that this happens. Check! Equation::factorize2_");
         }
       }
-      if (found) break;
-    } while ((*i)->permute(proj));
+    }
   }
+  Stats::get().add("duplicates", "permutations", npermutation);
+  Stats::get().add("duplicates", "merged", rm.size());
   for (auto& it : rm) diagram_.erase(it);
 }
 
 
 void Equation::simplify() {
+  Arena::Scope scope(arena_);
+  // only diagrams with the same shape can be identical
+  unordered_map<string, vector<list<shared_ptr<Diagram>>::iterator>> bucket;
+  for (auto i = diagram_.begin(); i != diagram_.end(); ++i)
+    bucket[(*i)->shape()].push_back(i);
+
   list<list<shared_ptr<Diagram>>::iterator> rm;
-  for (auto i = diagram_.begin(); i != diagram_.end(); ++i) {
-    // find identical
-    auto j = i;
-    for (++j ; j != diagram_.end(); ++j) {
-      if ((*i)->identical(*j)) {
-        (*j)->merge_active(*i);
-        rm.push_back(i);
+  for (auto& b : bucket) {
+    for (auto i = b.second.begin(); i != b.second.end(); ++i) {
+      // find identical
+      for (auto j = i+1; j != b.second.end(); ++j) {
+        if ((**i)->identical(**j)) {
+          (**j)->merge_active(**i);
+          rm.push_back(*i);
+        }
       }
     }
   }
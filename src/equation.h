@@ -26,7 +26,7 @@
 #ifndef __EQUATION_H
 #define __EQUATION_H
 
-#include "diagram.h"
+#include "flatdiagram.h"
 
 namespace smith {
 
@@ -39,12 +39,27 @@ class Equation {
     /// Internal function used by to find double permutations. Also if bool is true, equations can become daggered, and where permutations cause an additional get_block to be added to the generated code.
     void duplicates_(const bool);
 
+    /// Internal function used in Wick's expansion. Contracts ** IN PLACE ** the first non-active daggered operator of a diagram with the i-th candidate.
+    /// Returns if it survives; completed diagrams are also appended to the last argument.
+    bool reduce_one_(FlatDiagram&, const int i, std::list<std::shared_ptr<Diagram>>&) const;
+    /// Internal function used in Wick's expansion. Returns if fully contracted diagrams derived from this diagram are dropped as <I|0> terms.
+    bool dropped_(const FlatDiagram&) const;
+    /// Internal function used in Wick's expansion. Expands a diagram depth first using the cached contraction paths (see FlatDiagram::pattern).
+    /// Completed diagrams are appended to done[l] and the number of daggered operators of the first diagram created is stored in first[l],
+    /// where l is the number of contractions relative to the argument minus one.
+    void expand_(const FlatDiagram&, std::vector<std::list<std::shared_ptr<Diagram>>>& done, std::vector<int>& first) const;
+
     /// Name of theory. Generated code for BAGEL will have this name, set in main.cc.
     std::string name_;
 
+    /// Memory arena for the indices, spins, and operators created while building this equation. Released when they are all gone.
+    std::shared_ptr<Arena> arena_;
+
   public:
     /// Construct equation from diagram and name. Contract operators in diagram.
     Equation(std::shared_ptr<Diagram>, std::string nam);
+    /// Construct equation from diagrams that are already contracted and the arena that holds their objects (see Snapshot).
+    Equation(std::list<std::shared_ptr<Diagram>> d, std::string nam, std::shared_ptr<Arena> a) : diagram_(d), name_(nam), arena_(a) { }
 
     /// Merging two sets of Equation.  Done by adding the diagrams of new equation (in merge arguement) to the original equation.
     void merge(const std::shared_ptr<Equation> o) {
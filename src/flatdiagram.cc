@@ -0,0 +1,353 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: flatdiagram.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include "flatdiagram.h"
+#include "constants.h"
+#include "stats.h"
+#include "diskcache.h"
+
+using namespace std;
+using namespace smith;
+
+
+bool FlatDiagram::contractable(const int a, const int b) {
+  return a == b || a == IndexMap::general || b == IndexMap::general;
+}
+
+
+FlatDiagram::FlatDiagram(const Diagram& d)
+ : nop_(0), fac_(d.fac()), bra_(d.braket().first), ket_(d.braket().second), dagger_(d.dagger()), absorbed_(d.absorbed()) {
+  auto label = make_shared<pair<vector<string>, string>>();
+  label->second = d.scalar();
+
+  // indices and spins are numbered in the order of appearance
+  vector<shared_ptr<const Index>> index;
+  vector<shared_ptr<const Spin>> spin;
+  int nslot = 0;
+  int nrho = 0;
+  op_[0] = 0;
+  rho_begin_[0] = 0;
+  for (auto& o : d.op()) {
+    if (nop_ == max_op || nslot + static_cast<int>(o->op().size()) > max_slot || nrho + static_cast<int>(o->rho().size()) > max_slot)
+      throw logic_error("diagram is too large in FlatDiagram::FlatDiagram");
+    label->first.push_back(o->label());
+    for (auto& i : o->op()) {
+      const shared_ptr<const Index> in = *get<0>(i);
+      auto iter = find(index.begin(), index.end(), in);
+      if (iter == index.end()) {
+        index_label_[index.size()] = in->space();
+        iter = index.insert(iter, in);
+      }
+      index_[nslot] = iter - index.begin();
+      state_[nslot] = get<1>(i);
+      rho_[nslot] = nrho + get<2>(i);
+      slot_dagger_[nslot] = in->dagger();
+      ++nslot;
+    }
+    for (auto& r : o->rho()) {
+      auto iter = find(spin.begin(), spin.end(), r);
+      if (iter == spin.end()) {
+        alpha_[spin.size()] = r->alpha();
+        parent_[spin.size()] = spin.size();
+        iter = spin.insert(iter, r);
+      }
+      spin_[nrho++] = iter - spin.begin();
+    }
+    ++nop_;
+    op_[nop_] = nslot;
+    rho_begin_[nop_] = nrho;
+  }
+  label_ = label;
+}
+
+
+shared_ptr<Diagram> FlatDiagram::diagram() const {
+  // Index and Spin objects for each id, created when the id first appears
+  array<shared_ptr<Index>, max_slot> index;
+  array<shared_ptr<Spin>, max_slot> spin;
+
+  list<shared_ptr<Operator>> op;
+  for (int k = 0; k != nop_; ++k) {
+    const int begin = op_[k];
+    auto lab = [&](const int s) { return IndexMap::get().label(index_label_[index_[begin+s]]); };
+    auto alpha = [&](const int r) { return alpha_[spin_root(spin_[rho_begin_[k]+r])]; };
+    // see Op::copy
+    shared_ptr<Operator> a;
+    switch (op_[k+1] - begin) {
+      case 4: a = arena_shared<Op>(label_->first[k], lab(0), lab(2), lab(3), lab(1), alpha(0), alpha(1)); break;
+      case 2: a = arena_shared<Op>(label_->first[k], lab(0), lab(1), alpha(0)); break;
+      case 0: a = arena_shared<Op>(label_->first[k]); break;
+      default: throw logic_error("unexpected operator in FlatDiagram::diagram");
+    }
+    auto j = a->op().begin();
+    for (int s = begin; s != op_[k+1]; ++s, ++j) {
+      shared_ptr<Index>& i = index[index_[s]];
+      if (!i) i = *get<0>(*j);
+      else *get<0>(*j) = i;
+      shared_ptr<Spin>& r = spin[spin_root(spin_[rho_[s]])];
+      if (!r) r = a->rho(get<2>(*j));
+      else a->set_rho(get<2>(*j), r);
+      get<1>(*j) = state_[s];
+    }
+    op.push_back(a);
+  }
+
+  auto out = arena_shared<Diagram>(op, fac_, label_->second, make_pair(bra_, ket_));
+  if (dagger_) out->add_dagger();
+  if (absorbed_) out->set_absorbed(true);
+  return out;
+}
+
+
+bool FlatDiagram::reduce_one_noactive(const int skip) {
+  const int nslot = op_[nop_];
+  // index numbers as in Diagram::refresh_indices; operators are numbered in order.
+  array<int, max_slot> num;
+  for (int s = 0, n = 0; s != nslot; ++s)
+    if (state_[s] != -1) num[s] = n++;
+
+  // find the first dagger operator and eliminate it
+  int dat = 0;
+  for (; dat != nslot; ++dat)
+    if (state_[dat] == 0 && slot_dagger_[dat]) break;
+  if (dat == nslot) return false;
+  state_[dat] = -1;
+  const int iop = upper_bound(op_.begin(), op_.begin()+nop_+1, dat) - op_.begin() - 1;
+
+  // skip until it comes to skip
+  int cnt = 0;
+  bool closed = false;
+  for (int j = 0; j != nop_; ++j) {
+    // cannot contract with self
+    if (j == iop) {
+      closed = true;
+      continue;
+    }
+    int nnodagger = 0;
+    for (int s = op_[j]; s != op_[j+1]; ++s)
+      if (state_[s] == 0 && !slot_dagger_[s]) ++nnodagger;
+    if (cnt + nnodagger <= skip) {
+      cnt += nnodagger;
+      continue;
+    }
+
+    // all possible contraction pattern taken for operator j; see Operator::contract
+    int s = op_[j];
+    for (int c = 0; s != op_[j+1]; ++s) {
+      if (state_[s] != 0 || slot_dagger_[s] || !contractable(index_label_[index_[s]], index_label_[index_[dat]])) continue;
+      if (c++ == skip-cnt) break;
+    }
+    if (s == op_[j+1]) return false;
+
+    double fac = (abs(num[s]-num[dat]) & 1) ? 1.0 : -1.0;
+    // the one to be kept; see Operator::survive
+    const int la = index_label_[index_[s]];
+    const int lb = index_label_[index_[dat]];
+    if (!contractable(la, lb)) throw logic_error("A strange thing happened in FlatDiagram::reduce_one_noactive");
+    const int kept = (la == lb || lb == IndexMap::general) ? index_[s] : index_[dat];
+    index_[s] = index_[dat] = kept;
+    state_[s] = -1;
+
+    const int newspin = find_spin(spin_[rho_[dat]]);
+    const int oldspin = find_spin(spin_[rho_[s]]);
+    // if closing a spin loop, multiply 2
+    fac *= (newspin == oldspin && !alpha_[newspin]) ? fac2 : 1.0;
+
+    const int label = index_label_[kept];
+    if (!((closed && label == IndexMap::closed) || (!closed && label == IndexMap::virt))) return false;
+    fac_ *= fac;
+    // if oldspin is restricted to alpha spin, we have to pass along that information
+    if (alpha_[oldspin])
+      alpha_[newspin] = true;
+    // all the spin entries of oldspin now refer to newspin
+    parent_[oldspin] = newspin;
+    return true;
+  }
+  return false;
+}
+
+
+bool FlatDiagram::valid() const {
+  int out = 0;
+  for (int k = 0; k != nop_; ++k)
+    if (any_of(state_.begin()+op_[k], state_.begin()+op_[k+1], [](const signed char s) { return s == 0; })) ++out;
+  return out > 1;
+}
+
+
+bool FlatDiagram::done() const {
+  return done_noactive();
+}
+
+
+bool FlatDiagram::done_noactive() const {
+  return none_of(state_.begin(), state_.begin()+op_[nop_], [](const signed char s) { return s == 0; });
+}
+
+
+int FlatDiagram::num_dagger() const {
+  int out = 0;
+  for (int s = 0; s != op_[nop_]; ++s)
+    if (state_[s] == 0 && slot_dagger_[s]) ++out;
+  return out;
+}
+
+
+bool FlatDiagram::feasible() const {
+  // numbers of daggered and non-daggered operators in closed, virtual, and general spaces
+  array<int, 3> ndagger, nnodagger;
+  ndagger.fill(0);
+  nnodagger.fill(0);
+  for (int s = 0; s != op_[nop_]; ++s) {
+    if (state_[s] != 0) continue;
+    const int label = index_label_[index_[s]];
+    // contraction survives only when the remaining label is closed or virtual; general indices are contracted with either of them.
+    const int l = label == IndexMap::closed ? 0 : label == IndexMap::virt ? 1 : label == IndexMap::general ? 2 : -1;
+    if (l < 0) return false;
+    ++(slot_dagger_[s] ? ndagger : nnodagger)[l];
+  }
+  return ndagger[0]+ndagger[1]+ndagger[2] == nnodagger[0]+nnodagger[1]+nnodagger[2]
+      && ndagger[0] <= nnodagger[0]+nnodagger[2] && ndagger[1] <= nnodagger[1]+nnodagger[2] && ndagger[2] <= nnodagger[0]+nnodagger[1];
+}
+
+
+bool FlatDiagram::gamma_derivative() const {
+  return any_of(state_.begin(), state_.begin()+op_[nop_], [](const signed char s) { return s == 2; });
+}
+
+
+string FlatDiagram::residual() const {
+  // spins are renumbered in the order of appearance among the operators
+  array<signed char, max_slot> spin;
+  spin.fill(-1);
+  int nspin = 0;
+  string out;
+  out.reserve(4*op_[nop_]+nop_);
+  for (int k = 0; k != nop_; ++k) {
+    if (all_of(state_.begin()+op_[k], state_.begin()+op_[k+1], [](const signed char s) { return s == -1; })) continue;
+    out += '|';
+    for (int s = op_[k]; s != op_[k+1]; ++s) {
+      if (state_[s] == -1) continue;
+      // active operators only contribute to the signs
+      if (state_[s] == 2) {
+        out += 'A';
+        continue;
+      }
+      const int r = spin_root(spin_[rho_[s]]);
+      if (spin[r] < 0) spin[r] = nspin++;
+      out += slot_dagger_[s] ? '+' : '-';
+      out += 'a' + index_label_[index_[s]];
+      out += 'a' + spin[r];
+      out += alpha_[r] ? 'A' : 'B';
+    }
+  }
+  return out;
+}
+
+
+string WickPattern::str() const {
+  stringstream ss;
+  ss << first.size();
+  for (auto& i : first) ss << " " << i;
+  ss << "\n" << path.size() << "\n";
+  for (auto& p : path) {
+    ss << p.size();
+    for (auto& i : p) ss << " " << static_cast<int>(i);
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+
+bool WickPattern::read(const string& in) {
+  stringstream ss(in);
+  size_t n;
+  ss >> n;
+  first.resize(n);
+  for (auto& i : first) ss >> i;
+  ss >> n;
+  path.resize(n);
+  for (auto& p : path) {
+    ss >> n;
+    p.resize(n);
+    for (auto& i : p) {
+      int j;
+      ss >> j;
+      i = j;
+    }
+  }
+  return !ss.fail();
+}
+
+
+shared_ptr<const WickPattern> FlatDiagram::pattern() const {
+  static unordered_map<string, shared_ptr<const WickPattern>> cache;
+  static mutex cache_mutex;
+
+  const string key = residual();
+  {
+    lock_guard<mutex> lock(cache_mutex);
+    auto iter = cache.find(key);
+    if (iter != cache.end()) return iter->second;
+  }
+
+  auto out = make_shared<WickPattern>();
+  string value;
+  if (DiskCache::get().load("wick", key, value) && out->read(value)) {
+    Stats::get().add("wick", "cache_hits");
+    lock_guard<mutex> lock(cache_mutex);
+    return cache.insert(make_pair(key, out)).first->second;
+  }
+
+  for (int i = 0; i != num_dagger(); ++i) {
+    FlatDiagram n = *this;
+    if (!n.reduce_one_noactive(i) || !(n.valid() || n.done())) continue;
+    if (out->first.empty()) out->first.push_back(n.num_dagger());
+    if (n.done_noactive())
+      out->path.push_back(vector<signed char>{static_cast<signed char>(i)});
+    if (n.num_dagger()) {
+      // diagrams that cannot be contracted completely only tell how deep the expansion goes, which is known once a sibling has gone to the end
+      if (out->first.size() == static_cast<size_t>(num_dagger()) && !n.feasible()) {
+        Stats::get().add("wick", "pruned");
+        continue;
+      }
+      shared_ptr<const WickPattern> sub = n.pattern();
+      for (auto& p : sub->path) {
+        out->path.push_back(vector<signed char>{static_cast<signed char>(i)});
+        out->path.back().insert(out->path.back().end(), p.begin(), p.end());
+      }
+      for (size_t d = 0; d != sub->first.size(); ++d)
+        if (out->first.size() == d+1) out->first.push_back(sub->first[d]);
+    }
+  }
+
+  Stats::get().add("wick", "patterns");
+  DiskCache::get().store("wick", key, out->str());
+  lock_guard<mutex> lock(cache_mutex);
+  return cache.insert(make_pair(key, out)).first->second;
+}
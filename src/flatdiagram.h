@@ -0,0 +1,141 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: flatdiagram.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __FLATDIAGRAM_H
+#define __FLATDIAGRAM_H
+
+#include <array>
+#include "diagram.h"
+
+namespace smith {
+
+/// Contraction paths from a diagram to its fully contracted descendants in Wick's expansion (see FlatDiagram::pattern).
+struct WickPattern {
+  /// The skip arguments of reduce_one_noactive leading to each fully contracted diagram, in the order of the depth-first expansion.
+  std::vector<std::vector<signed char>> path;
+  /// The number of daggered indices of the first diagram that survives at each depth.
+  std::vector<int> first;
+
+  /// Returns this pattern as text (see DiskCache).
+  std::string str() const;
+  /// Reads a pattern written by str(). Returns false if the text is broken.
+  bool read(const std::string& in);
+};
+
+/// Compact encoding of a Diagram used in Wick's expansion. Operators, index slots, indices and spins are referred to by small integer ids
+/// stored in fixed-size arrays, so that copying a diagram is a flat copy of this object. Converted from and to Diagram at both ends of the expansion.
+class FlatDiagram {
+  public:
+    /// Maximum number of operators.
+    static const int max_op = 8;
+    /// Maximum number of index slots (and hence of indices and spins).
+    static const int max_slot = 32;
+
+  protected:
+    /// Labels of the operators and the scalar, which do not change during the expansion. Shared by all the diagrams derived from the same one.
+    std::shared_ptr<const std::pair<std::vector<std::string>, std::string>> label_;
+
+    /// Number of operators.
+    int nop_;
+    /// Offset of the first slot of each operator. The last element is the total number of slots.
+    std::array<signed char, max_op+1> op_;
+    /// Offset of the first spin entry (rho) of each operator. The last element is the total number of spin entries.
+    std::array<signed char, max_op+1> rho_begin_;
+
+    /// Index id of each slot. Contracted pairs of slots share the id.
+    std::array<signed char, max_slot> index_;
+    /// Operator info of each slot; -1: no operator (i.e., already contracted), 0: operator, 2: active operator (see Operator::op_).
+    std::array<signed char, max_slot> state_;
+    /// Spin entry of each slot.
+    std::array<signed char, max_slot> rho_;
+    /// Dagger info of each slot.
+    std::array<bool, max_slot> slot_dagger_;
+
+    /// Index class of each index id (see IndexMap).
+    std::array<signed char, max_slot> index_label_;
+    /// Spin id of each spin entry. Spin entries correspond to Operator::rho_.
+    std::array<signed char, max_slot> spin_;
+    /// Parent of each spin id. Spins merged by contractions form a tree (union-find); the root represents them.
+    std::array<signed char, max_slot> parent_;
+    /// Alpha info of each spin id. Only valid for roots.
+    std::array<bool, max_slot> alpha_;
+
+    /// A constant factor.
+    double fac_;
+    /// Bra and ket.
+    bool bra_, ket_;
+    /// If this has a daggered counterpart.
+    bool dagger_;
+    /// If this has absorbed a ket.
+    bool absorbed_;
+
+    /// Returns the spin id that represents a spin id (see parent_).
+    int spin_root(int s) const { while (parent_[s] != s) s = parent_[s]; return s; }
+    /// Same as above, but compresses the path on the way.
+    int find_spin(int s) {
+      while (parent_[s] != s) {
+        parent_[s] = parent_[parent_[s]];
+        s = parent_[s];
+      }
+      return s;
+    }
+
+    /// Returns if two indices (given by index class ids) can be contracted.
+    static bool contractable(const int a, const int b);
+
+  public:
+    /// Encodes a diagram. Operators should not have been permuted.
+    FlatDiagram(const Diagram& d);
+
+    /// Returns a Diagram with the same topology as this.
+    std::shared_ptr<Diagram> diagram() const;
+
+    /// This function performs one contraction ** IN PLACE **, the skip-th one for the first non-active daggered operator. Returns false if it does not survive.
+    bool reduce_one_noactive(const int skip);
+
+    /// Returns if this diagram is still valid (see Diagram::valid).
+    bool valid() const;
+    /// Returns if this diagram is fully contracted.
+    bool done() const;
+    /// Returns if this diagram is fully contracted (looking up only nonactive parts).
+    bool done_noactive() const;
+    /// The number of daggered non-active indices in operators.
+    int num_dagger() const;
+    /// Returns if the remaining operators can be contracted completely, judging from the numbers of creation and annihilation operators in each orbital space.
+    bool feasible() const;
+    /// Returns if there are active operators.
+    bool gamma_derivative() const;
+    /// Returns the bra and ket.
+    std::pair<bool, bool> braket() const { return std::make_pair(bra_, ket_); }
+
+    /// Returns a key of the operators that are not contracted yet, which determine all the subsequent contractions.
+    std::string residual() const;
+    /// Returns the contraction paths of this diagram. They are cached by residual() and shared by all the diagrams in this run.
+    std::shared_ptr<const WickPattern> pattern() const;
+};
+
+}
+
+#endif
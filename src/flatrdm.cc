@@ -0,0 +1,169 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: flatrdm.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <algorithm>
+#include <set>
+#include "flatrdm.h"
+#include "constants.h"
+
+using namespace std;
+using namespace smith;
+
+
+FlatRDM::FlatRDM(shared_ptr<RDM> in) : size_(in->index().size()), ndelta_(0), fac_(in->factor()) {
+  assert(supported(*in));
+  auto root = make_shared<Root>();
+  root->rdm = in;
+  root->derived = static_cast<bool>(dynamic_pointer_cast<RDMI0>(in));
+  int n = 0;
+  for (auto& i : in->index()) {
+    root->index.push_back(i);
+    auto s = find(root->spin.begin(), root->spin.end(), i->spin());
+    spin_[n] = s - root->spin.begin();
+    if (s == root->spin.end()) root->spin.push_back(i->spin());
+    index_[n] = n;
+    ++n;
+  }
+  root_ = root;
+}
+
+
+bool FlatRDM::supported(const RDM& in) {
+  set<int> num;
+  for (auto& i : in.index())
+    if (!i->has_spin() || !num.insert(i->num()).second) return false;
+  return in.delta().empty() && in.index().size() <= static_cast<size_t>(max_index);
+}
+
+
+vector<FlatRDM> FlatRDM::reduce_one(unsigned int& done) const {
+  vector<FlatRDM> out;
+  const vector<shared_ptr<const Index>>& index = root_->index;
+  const vector<shared_ptr<Spin>>& spin = root_->spin;
+
+  // first find non-daggered operator which is not aligned
+  for (int i = 0; i != size_; ++i) {
+    if (index[index_[i]]->dagger() || (done & (1u << index_[i])))
+      continue;
+
+    for (int j = i+1; j != size_; ++j) {
+      if (!index[index_[j]]->dagger()) continue;
+
+      FlatRDM tmp = *this;
+      tmp.fac_ *= ((j-i-1)&1 ? -1.0 : 1.0);
+      if (spin_[i] == spin_[j]) {
+        // if spin loop closes, we multiply 2 in spin-free cases
+        if (root_->derived || !spin[spin_[i]]->alpha())
+          tmp.fac_ *= fac2;
+      } else {
+        // this case we need to replace a spin; for RDM00, alpha-only information should survive this step
+        int s0 = spin_[i];
+        int s1 = spin_[j];
+        if (!root_->derived && spin[s0]->alpha()) swap(s0, s1);
+        for (int k = 0; k != size_; ++k)
+          if (tmp.spin_[k] == s0) tmp.spin_[k] = s1;
+      }
+      tmp.delta_[tmp.ndelta_++] = make_pair(index_[i], index_[j]);
+      tmp.delta_spin_ = make_pair(tmp.spin_[i], tmp.spin_[j]);
+      tmp.last_ = make_pair(i, j);
+
+      // erasing indices which are in delta
+      int n = 0;
+      for (int k = 0; k != size_; ++k) {
+        if (k == i || k == j) continue;
+        tmp.index_[n] = tmp.index_[k];
+        tmp.spin_[n] = tmp.spin_[k];
+        ++n;
+      }
+      tmp.size_ = n;
+      out.push_back(tmp);
+    }
+    done |= 1u << index_[i];
+    break;
+  }
+  return out;
+}
+
+
+bool FlatRDM::reduce_done(const unsigned int done) const {
+  // check if there is a annihilation operator which has creation operators in his right side
+  const vector<shared_ptr<const Index>>& index = root_->index;
+  for (int i = 0; i != size_; ++i) {
+    if (!index[index_[i]]->dagger() && !(done & (1u << index_[i]))) {
+      for (int j = i; j != size_; ++j)
+        if (index[index_[j]]->dagger()) return false;
+      break;
+    }
+  }
+  return true;
+}
+
+
+shared_ptr<RDM> FlatRDM::rdm() const {
+  if (ndelta_ == 0) return root_->rdm;
+
+  const vector<shared_ptr<const Index>>& index = root_->index;
+  const vector<shared_ptr<Spin>>& spin = root_->spin;
+
+  // RDM::copy clones the indices of the previous RDM (including the two in the last delta function), then the earlier delta functions.
+  // Clones share the core with the original.
+  list<shared_ptr<const Index>> in;
+  shared_ptr<const Index> first, second;
+  for (int k = 0, n = 0; k != size_+2; ++k) {
+    shared_ptr<Index> i;
+    if (k == last_.first) {
+      i = index[delta_[ndelta_-1].first]->clone();
+      i->set_spin(spin[delta_spin_.first]);
+      first = i;
+    } else if (k == last_.second) {
+      i = index[delta_[ndelta_-1].second]->clone();
+      i->set_spin(spin[delta_spin_.second]);
+      second = i;
+    } else {
+      i = index[index_[n]]->clone();
+      i->set_spin(spin[spin_[n]]);
+      in.push_back(i);
+      ++n;
+    }
+  }
+
+  // the latest delta function comes first as the clones of the earlier ones are made later
+  map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder> d;
+  d.insert(make_pair(first, second));
+  for (int k = ndelta_-2; k >= 0; --k) {
+    shared_ptr<const Index> a = index[delta_[k].first]->clone();
+    shared_ptr<const Index> b = index[delta_[k].second]->clone();
+    d.insert(make_pair(a, b));
+  }
+
+  const pair<bool, bool> braket = root_->rdm->braket();
+  shared_ptr<RDM> out;
+  if (root_->derived)
+    out = make_shared<RDMI0>(in, d, braket, fac_);
+  else
+    out = make_shared<RDM00>(in, d, braket, fac_);
+  return out;
+}
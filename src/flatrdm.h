@@ -0,0 +1,95 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: flatrdm.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __FLATRDM_H
+#define __FLATRDM_H
+
+#include <array>
+#include "rdm.h"
+#include "rdm00.h"
+#include "rdmI0.h"
+
+namespace smith {
+
+/// Compact encoding of an RDM used in Active::reduce. Indices are referred to by their position in the RDM the reduction starts from,
+/// and spins by small integer ids, so that taking a delta function is a flat copy of this object. Only the final RDMs are converted back.
+class FlatRDM {
+  public:
+    /// Maximum number of indices.
+    static const int max_index = 16;
+
+  protected:
+    /// Data of the RDM the reduction starts from. Shared by all the RDMs derived from it.
+    struct Root {
+      /// The RDM itself.
+      std::shared_ptr<RDM> rdm;
+      /// Its indices.
+      std::vector<std::shared_ptr<const Index>> index;
+      /// Spins of its indices; the spin ids refer to this.
+      std::vector<std::shared_ptr<Spin>> spin;
+      /// If this is RDMI0.
+      bool derived;
+    };
+    std::shared_ptr<const Root> root_;
+
+    /// Number of indices.
+    int size_;
+    /// Indices in the order of RDM::index().
+    std::array<signed char, max_index> index_;
+    /// Spin id of each index.
+    std::array<signed char, max_index> spin_;
+
+    /// Number of delta functions.
+    int ndelta_;
+    /// Delta functions in the order they are taken.
+    std::array<std::pair<signed char, signed char>, max_index/2> delta_;
+    /// Spin ids of the indices in the last delta function.
+    std::pair<signed char, signed char> delta_spin_;
+    /// Positions of the indices in the last delta function before they are removed.
+    std::pair<signed char, signed char> last_;
+
+    /// A constant factor.
+    double fac_;
+
+  public:
+    /// Encodes an RDM without delta functions.
+    FlatRDM(std::shared_ptr<RDM> in);
+
+    /// Returns if an RDM can be encoded: no delta functions, distinct index numbers, and at most max_index indices.
+    static bool supported(const RDM& in);
+
+    /// Same as RDM::reduce_one. done holds the positions of the processed indices as bits.
+    std::vector<FlatRDM> reduce_one(unsigned int& done) const;
+    /// Same as RDM::reduce_done.
+    bool reduce_done(const unsigned int done) const;
+
+    /// Returns an RDM with the same indices, delta functions and factor as the copies in RDM::reduce_one would have.
+    std::shared_ptr<RDM> rdm() const;
+};
+
+}
+
+#endif
@@ -26,16 +26,20 @@
 #include <tuple>
 #include "forest.h"
 #include "constants.h"
+#include "cumulant.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
 
 void Forest::filter_gamma() {
+  Stats::Timer timer("filter_gamma");
   shared_ptr<Tree> res;
 
   bool first = true;
   list<shared_ptr<Tensor>> prev;
+  GammaTable table(gamma_);
   for (auto& i : trees_) {
     list<shared_ptr<Tensor>> g;
     if (first) {
@@ -48,23 +52,18 @@ void Forest::filter_gamma() {
 
     g = i->gamma();
 
-    for (auto& j : g) {
-      bool found = false;
-        for (auto& k : gamma_) {
-          if ((*j) == (*k)) {
-            found = true;
-            break;
-          }
-        }
-      if (!found) gamma_.push_back(j);
-    }
+    for (auto& j : g)
+      if (!table.find(*j)) table.add(j);
     prev = i->gamma();
   }
+  gamma_ = table.gamma();
+  Stats::get().set("filter_gamma", "gammas", gamma_.size());
 
 }
 
 
 OutStream Forest::generate_code() const {
+  Stats::Timer timer("generate_code");
   OutStream out, tmp;
   string depends, tasks, specials;
 
@@ -86,6 +85,8 @@ OutStream Forest::generate_code() const {
 
   out << generate_algorithm();
 
+  Stats::get().add("generate_code", "bytes", out.ss.str().size() + out.tt.str().size() + out.cc.str().size()
+                                            + out.dd.str().size() + out.ee.str().size() + out.gg.str().size());
   return out;
 }
 
@@ -179,11 +180,24 @@ OutStream Forest::generate_headers() const {
   out.cc << "using namespace bagel::SMITH;" << endl;
   out.cc << "using namespace bagel::SMITH::" << forest_name_ << ";" << endl << endl;
 
+  // 4-RDMs rebuilt from their cumulants are computed by a class defined in the tasks file
+  bool cumulant = false;
+  for (auto& i : gamma_)
+    if (!i->der() && i->active())
+      for (auto& j : i->active()->rdm())
+        cumulant |= j->cumulant();
+
+  if (cumulant) {
+    out.dd << "#include <map>" << endl;
+    out.dd << "#include <numeric>" << endl;
+  }
   out.dd << "#include <src/smith/" << forest_name_lower << "/" << forest_name_ << "_tasks.h>" << endl << endl;
   out.dd << "using namespace std;" << endl;
   out.dd << "using namespace bagel;" << endl;
   out.dd << "using namespace bagel::SMITH;" << endl;
   out.dd << "using namespace bagel::SMITH::" << forest_name_ << ";" << endl << endl;
+  if (cumulant)
+    out.dd << Cumulant::generate_block_class();
 
   out.gg << "#include <src/smith/" << forest_name_lower << "/" << forest_name_ << ".h>" << endl;
   out.gg << "#include <src/smith/" << forest_name_lower << "/" << forest_name_ << "_tasks.h>" << endl << endl;
@@ -223,8 +237,8 @@ OutStream Forest::generate_gammas() const {
     out << i->generate_gamma(icnt, use_blas, i->der());
 
     vector<string> tmp = {i->label()};
-    const bool merged = i->merged() ? true : false;
-    vector<string> rdms = i->active()->required_rdm(merged);
+    // the 4RDM is contracted a priori with a single merged tensor only
+    vector<string> rdms = i->active()->required_rdm(i->merged().size() == 1);
     if (i->der()) { // derivative rdm
       for (auto& j : rdms) {
         stringstream zz;
@@ -238,11 +252,11 @@ OutStream Forest::generate_gammas() const {
         tmp.push_back(zz.str());
       }
     }
-    if (i->merged()) {
-      // 4RDM derivative is a priori contracted with the fock operator
-      if (!i->der() || !(rdms.size() == 1 && rdms[0] == "rdm4")) {
+    // 4RDM derivative is a priori contracted with the fock operator
+    if (!i->der() || !(rdms.size() == 1 && rdms[0] == "rdm4")) {
+      for (auto& j : i->merged()) {
         stringstream mm;
-        mm << i->merged()->label() << "_";
+        mm << j->label() << "_";
         tmp.push_back(mm.str());
       }
     }
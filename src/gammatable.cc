@@ -0,0 +1,71 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: gammatable.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <numeric>
+#include "gammatable.h"
+
+using namespace std;
+using namespace smith;
+
+
+void GammaTable::add(shared_ptr<Tensor> o) {
+  exact_.insert(make_pair(o->fingerprint(), o));
+  vector<int> identity(o->index().size());
+  iota(identity.begin(), identity.end(), 0);
+  const string key = o->gamma_key(identity);
+  if (!key.empty())
+    key_[key].push_back(make_pair(gamma_.size(), o));
+  gamma_.push_back(o);
+}
+
+
+shared_ptr<Tensor> GammaTable::find(const Tensor& o) const {
+  auto iter = exact_.find(o.fingerprint());
+  return iter != exact_.end() ? iter->second : nullptr;
+}
+
+
+pair<shared_ptr<Tensor>, vector<int>> GammaTable::find_permuted(const Tensor& o) const {
+  // the earliest registered Gamma wins; for each, the first order
+  int position = gamma_.size();
+  pair<shared_ptr<Tensor>, vector<int>> out;
+  const vector<shared_ptr<const Index>> mine(o.index().begin(), o.index().end());
+  for (auto& order : o.gamma_orders()) {
+    auto iter = key_.find(o.gamma_key(order));
+    if (iter == key_.end()) continue;
+    for (auto& i : iter->second) {
+      if (i.first >= position || i.second->index().size() != mine.size()) continue;
+      const vector<shared_ptr<const Index>> theirs(i.second->index().begin(), i.second->index().end());
+      bool same_space = true;
+      for (size_t k = 0; k != mine.size(); ++k)
+        same_space &= mine[k]->space() == theirs[order[k]]->space();
+      if (!same_space) continue;
+      position = i.first;
+      out = make_pair(i.second, order);
+    }
+  }
+  return out;
+}
@@ -0,0 +1,64 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: gammatable.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __GAMMATABLE_H
+#define __GAMMATABLE_H
+
+#include <unordered_map>
+#include "tensor.h"
+
+namespace smith {
+
+/// Distinct Gamma tensors in the order they are first seen. Each Gamma is hashed once: by Tensor::fingerprint for exact matches,
+/// and by Tensor::gamma_key for matches up to the order of indices.
+class GammaTable {
+  protected:
+    /// Registered Gammas.
+    std::list<std::shared_ptr<Tensor>> gamma_;
+    /// Registered Gammas by fingerprint. Only the first one for each fingerprint is kept.
+    std::unordered_map<std::string, std::shared_ptr<Tensor>> exact_;
+    /// Registered Gammas by gamma_key with their indices in order, with their position in gamma_.
+    std::unordered_map<std::string, std::vector<std::pair<int, std::shared_ptr<Tensor>>>> key_;
+
+  public:
+    GammaTable() { }
+    /// Registers Gammas in order.
+    GammaTable(const std::list<std::shared_ptr<Tensor>>& o) { for (auto& i : o) add(i); }
+
+    /// Registers a Gamma.
+    void add(std::shared_ptr<Tensor> o);
+    /// Returns the first registered Gamma equal to o, or nullptr.
+    std::shared_ptr<Tensor> find(const Tensor& o) const;
+    /// Returns the first registered Gamma that is equal to o up to the order of indices, with the position of each index of o in it.
+    std::pair<std::shared_ptr<Tensor>, std::vector<int>> find_permuted(const Tensor& o) const;
+
+    /// Returns registered Gammas.
+    const std::list<std::shared_ptr<Tensor>>& gamma() const { return gamma_; }
+};
+
+}
+
+#endif
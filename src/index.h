@@ -32,6 +32,9 @@
 #include <list>
 #include <iostream>
 #include <cassert>
+#include <atomic>
+#include "arena.h"
+#include "indexmap.h"
 
 namespace smith {
 
@@ -67,8 +70,8 @@ class Spin {
 /// A class for tensor indices. Can refer to orbital attributes: Index defined by label (space), spin, electron number and if is transposed (daggered). Also can refer to cI index.
 class Index_Core {
   protected:
-    /// Index label, related to closed, active, or virtual (c, x, and a, respectively).
-    std::string label_;
+    /// Index class id, related to closed, active, or virtual (c, x, and a, respectively). See IndexMap.
+    int label_;
     /// Index number (if orbital index, electron).
     int num_;
     /// If transposed, ie daggered. Important in Wick's theorem and equations.
@@ -76,7 +79,7 @@ class Index_Core {
 
   public:
     /// Make index object from label and dagger info. Initialize label, number(0), dagger.
-    Index_Core(std::string lab, bool dag) : label_(lab), num_(0), dagger_(dag) {}
+    Index_Core(std::string lab, bool dag) : label_(IndexMap::get().type(lab)), num_(0), dagger_(dag) {}
     /// Make a copy of the index
     Index_Core(const Index_Core& o) : label_(o.label_), num_(o.num_), dagger_(o.dagger_) { }
     /// Make copy of the index but with reversed dagger info
@@ -91,9 +94,13 @@ class Index_Core {
     /// Set index number.
     void set_num(const int i) { num_ = i; }
     /// Return index label (orbital type).
-    const std::string label() const { return label_; }
+    const std::string& label() const { return IndexMap::get().label(label_); }
     /// Set index type, default is a (virtual).
-    void set_label(const std::string& a) { label_ = a; }
+    void set_label(const std::string& a) { label_ = IndexMap::get().type(a); }
+    /// Return index class id.
+    int space() const { return label_; }
+    /// Set index class id.
+    void set_space(const int a) { label_ = a; }
 };
 
 class Index {
@@ -103,18 +110,31 @@ class Index {
     std::shared_ptr<Index_Core> core_;
     /// Spin of index.
     mutable std::shared_ptr<Spin> spin_; // TODO mutable should be removed
+    /// Serial number in the order of construction. Used to order containers keyed on indices independently of heap addresses.
+    unsigned long serial_;
+
+    /// Returns the next serial number. Thread safe.
+    static unsigned long next_serial() {
+      static std::atomic<unsigned long> counter(0ul);
+      return counter++;
+    }
 
   public:
     /// Make index object from label and dagger info. Initialize label, number(0), dagger.
-    Index(std::string lab, bool dag) { core_ = std::make_shared<Index_Core>(lab, dag); }
-    Index(const Index& o) : spin_(o.spin_) { core_ = std::make_shared<Index_Core>(*o.core_); }
+    Index(std::string lab, bool dag) : serial_(next_serial()) { core_ = arena_shared<Index_Core>(lab, dag); }
+    Index(const Index& o) : spin_(o.spin_), serial_(next_serial()) { core_ = arena_shared<Index_Core>(*o.core_); }
     /// Make copy of the index but with reversed dagger info
-    Index(const Index& o, bool b) : spin_(o.spin_) { core_ = std::make_shared<Index_Core>(*o.core_, b); }
+    Index(const Index& o, bool b) : spin_(o.spin_), serial_(next_serial()) { core_ = arena_shared<Index_Core>(*o.core_, b); }
     /// Make copy of index but with altered number
-    Index(const Index& o, int i) : spin_(o.spin_) { core_ = std::make_shared<Index_Core>(*o.core_, i); }
-    Index(std::shared_ptr<Index_Core> c) : core_(c) { }
+    Index(const Index& o, int i) : spin_(o.spin_), serial_(next_serial()) { core_ = arena_shared<Index_Core>(*o.core_, i); }
+    Index(std::shared_ptr<Index_Core> c) : core_(c), serial_(next_serial()) { }
     ~Index() { }
 
+    /// Returns serial number.
+    unsigned long serial() const { return serial_; }
+    /// Returns the core (label, number and dagger), which is shared with clones.
+    std::shared_ptr<Index_Core> core() const { return core_; }
+
     /// Return index number.
     int num() const { return core_->num(); }
     /// Return if should be transposed.
@@ -122,17 +142,21 @@ class Index {
     /// Set index number.
     void set_num(const int i) { core_->set_num(i); }
     /// Return index label (orbital type).
-    std::string label() const { return core_->label(); }
+    const std::string& label() const { return core_->label(); }
     /// Set index type, default is a (virtual).
     void set_label(const std::string& a) { core_->set_label(a); }
+    /// Return index class id (see IndexMap).
+    int space() const { return core_->space(); }
+    /// Set index class id.
+    void set_space(const int a) { core_->set_space(a); }
 
     /// If active.  Checks label if active (x).
-    bool active() const { return label() == "x"; }
+    bool active() const { return space() == IndexMap::active; }
 
     /// Returns true if index number is same for both indices.
     bool same_num(const std::shared_ptr<const Index>& o) const { return o->num() == num(); }
     /// Returns true if label is same for both indices.
-    bool same_label(const std::shared_ptr<const Index>& o) const { return o->label() == label(); }
+    bool same_label(const std::shared_ptr<const Index>& o) const { return o->space() == space(); }
 
     /// Returns string with index label_, and if argument is true: dagger info (nothing or if daggered, +) and spin info.
     std::string str(const bool opr = true) const {
@@ -159,55 +183,44 @@ class Index {
     /// Returns const spin.
     const std::shared_ptr<Spin> spin() const { assert(spin_); return spin_; }
 
+    /// Returns if spin is set.
+    bool has_spin() const { return static_cast<bool>(spin_); }
     /// Returns true if spin is same for both indices.
     bool same_spin(const std::shared_ptr<const Index>& o) const { return o->spin() == spin(); }
 
     /// Clone Index with label_, num_ and dagger_ info. Note that this does not set spin.
     std::shared_ptr<Index> clone() const {
-      return std::make_shared<Index>(core_);
+      return arena_shared<Index>(core_);
     }
 
     /// Check if indices are equal by comparing num() and label(). Be careful that this does not check dagger! Should not check, actually.
     bool identical(std::shared_ptr<const Index> o) const {
-      return num() == o->num() && label() == o->label() && ((!spin_ && !o->spin_) || (spin()->alpha() == o->spin()->alpha()));
+      return num() == o->num() && space() == o->space() && ((!spin_ && !o->spin_) || (spin()->alpha() == o->spin()->alpha()));
     }
 
     /// Gives orbital space name (closed_, virt_, active_) based on index label_.
     std::string generate() const {
-      std::string out;
-      if (label() == "c") {
-        out = "closed_";
-      } else if (label() == "a") {
-        out = "virt_";
-      } else if (label() == "x") {
-        out = "active_";
-      } else if (label() == "ci") {
-        out = "ci_";
-      } else {
+      const OrbitalSpace& space = IndexMap::get().space(this->space());
+      if (space.name.empty())
         throw std::runtime_error("unkonwn index type in Index::generate()");
-      }
-      return out;
+      return space.name;
     }
 
     /// Gives index range name ([0], [1], [2] for closed, active, virtual orbital spaces, respectively and [3] for ci range) based on index label.
     std::string generate_range(const std::string postfix = "") const {
-      std::string out = "range" + postfix;
-      if (label() == "c") {
-        out += "[0]";
-      } else if (label() == "x") {
-        out += "[1]";
-      } else if (label() == "a") {
-        out += "[2]";
-      } else if (label() == "ci") {
-        out += "[3]";
-      } else {
+      const OrbitalSpace& space = IndexMap::get().space(this->space());
+      if (space.range < 0)
         throw std::runtime_error("unkonwn index type in Index::generate_range()");
-      }
-      return out;
+      return "range" + postfix + "[" + std::to_string(space.range) + "]";
     }
 
 };
 
+/// Comparison functor that orders indices by construction. Used as a key comparison in maps of indices.
+struct IndexOrder {
+  bool operator()(const std::shared_ptr<const Index>& a, const std::shared_ptr<const Index>& b) const { return a->serial() < b->serial(); }
+};
+
 }
 
 #endif
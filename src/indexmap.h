@@ -30,7 +30,7 @@
 #include <iostream>
 #include <vector>
 #include <memory>
-#include <list>
+#include <unordered_map>
 #include <stdexcept>
 
 namespace smith {
@@ -39,39 +39,79 @@ namespace smith {
 // to more general cases (RASPT2, for instance), then just add some entry.
 // Indices will be sorted using these numbers when tensors are canonicalized.
 
-/// Defines index classes.
+/// Attributes of an index class (orbital space).
+struct OrbitalSpace {
+  /// Label of indices in this space (e.g., "c").
+  std::string label;
+  /// Name of the index range in the generated code (e.g., "closed_"). Empty if the space does not appear in the generated code.
+  std::string name;
+  /// Position in the range array of the generated code and in the cost vectors; -1 if the space does not appear in the generated code.
+  int range;
+  /// Typical size used to estimate the cost.
+  int size;
+};
+
+/// Registry of index classes. Indices refer to the classes by the id, which is the position in this registry.
 class IndexMap {
   protected:
     /// This is list of index classes.
-    std::list<std::pair<std::string, std::pair<int,int>> > map_;
-  public:
+    std::vector<OrbitalSpace> map_;
+    /// Ids of the labels.
+    std::unordered_map<std::string, int> id_;
+    /// Number of classes that appear in the generated code.
+    int num_range_;
+
     /// Construct index classes.
-    IndexMap() {
-      map_.push_back(std::make_pair("c", std::make_pair(0, 28)));
-      map_.push_back(std::make_pair("x", std::make_pair(1, 6)));
-      map_.push_back(std::make_pair("a", std::make_pair(2, 232)));
-      map_.push_back(std::make_pair("ci", std::make_pair(3, 2000)));
+    IndexMap() : num_range_(0) {
+      add("c", "closed_", 28);
+      add("x", "active_", 6);
+      add("a", "virt_", 232);
+      add("ci", "ci_", 2000);
+      add("g", "", 0);
     }
-    ~IndexMap() { }
+
+  public:
+    /// Ids of the built-in classes.
+    enum : int { closed = 0, active = 1, virt = 2, ci = 3, general = 4 };
+
+    /// Returns the registry.
+    static IndexMap& get() {
+      static IndexMap map;
+      return map;
+    }
+
+    /// Adds an index class and returns its id. An empty name means that the class is not used in the generated code. Not thread safe.
+    int add(const std::string& label, const std::string& name, const int size) {
+      if (id_.count(label)) throw std::logic_error("index class " + label + " is already registered in IndexMap::add");
+      map_.push_back({label, name, name.empty() ? -1 : num_range_, size});
+      if (!name.empty()) ++num_range_;
+      return id_[label] = map_.size()-1;
+    }
+
     /// Returns map_ size.
     int num_orb_class() const { return map_.size(); }
     /// Also returns map_ size.
     int size() const { return num_orb_class(); }
+    /// Returns the number of classes that appear in the generated code.
+    int num_range() const { return num_range_; }
 
-    /// Returns class type based on map_.
-    const int type(const std::string& type_) const {
-      auto iter = map_.begin();
-      for (; iter != map_.end(); ++iter) if (iter->first == type_) break;
-      if (iter == map_.end()) throw std::runtime_error("key is no valid in Index::type()");
-      return iter->second.first;
+    /// Returns class id of a label.
+    int type(const std::string& type_) const {
+      auto iter = id_.find(type_);
+      if (iter == id_.end()) throw std::runtime_error("key is no valid in Index::type()");
+      return iter->second;
     }
+    /// Returns the attributes of a class.
+    const OrbitalSpace& space(const int id) const { return map_[id]; }
+    /// Returns the label of a class.
+    const std::string& label(const int id) const { return map_[id].label; }
+
     /// Returns index class beginning iterator.
-    std::list<std::pair<std::string, std::pair<int,int>> >::const_iterator begin() const { return map_.begin(); }
+    std::vector<OrbitalSpace>::const_iterator begin() const { return map_.begin(); }
     /// Returns index class end iterator.
-    std::list<std::pair<std::string, std::pair<int,int>> >::const_iterator end() const { return map_.end(); }
+    std::vector<OrbitalSpace>::const_iterator end() const { return map_.end(); }
 };
 
 }
 
 #endif
-
@@ -26,6 +26,7 @@
 #include <iomanip>
 #include <algorithm>
 #include "listtensor.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
@@ -80,6 +81,8 @@ void ListTensor::absorb_all_internal() {
   list<list<shared_ptr<Tensor>>::iterator> remove;
   for (auto i = list_.begin(); i != list_.end(); ++i) {
     if ((*i)->all_active() && !(*i)->active() && (*i)->label() != "proj") {
+      // a tensor that is not fully contracted with the Gamma cannot be chained after another one
+      if (!(*j)->merged().empty() && !(*j)->contracts_all(*i)) continue;
       (*j)->merge(*i);
       remove.push_back(i);
     }
@@ -101,7 +104,7 @@ void ListTensor::absorb_ket() {
         list<shared_ptr<const Index>> tmp;
         tmp = (*i)->index();
         for (auto& j : tmp) {  // check to make sure not ci target index
-          if (j->label() != "ci"){
+          if (j->space() != IndexMap::ci){
             ind.push_back(j);
           }
         }
@@ -115,7 +118,7 @@ void ListTensor::absorb_ket() {
           if (!j->active()) {
             newind.push_back(j);
           } else {
-            shared_ptr<const Index> tmp = make_shared<const Index>(*j,rdm_num_map[j->num()]);
+            shared_ptr<const Index> tmp = arena_shared<const Index>(*j,rdm_num_map[j->num()]);
             newind.push_back(tmp);
           }
         }
@@ -161,7 +164,7 @@ shared_ptr<Tensor> ListTensor::target() const {
       list<shared_ptr<const Index>>::iterator remove;
       for (auto i = ind.begin(); i != ind.end(); ++i) {
         if ((*i)->num() == (*j)->num()) {
-          if ((*j)->label() == "ci") break;   // todo is there a better way?
+          if ((*j)->space() == IndexMap::ci) break;   // todo is there a better way?
           found = true;
           remove = i;
           break;
@@ -243,12 +246,10 @@ shared_ptr<Cost> ListTensor::calculate_cost() const {
     }
 
     sumindex.insert(sumindex.end(), outindex.begin(), outindex.end());
-    vector<int> cost(4);
+    vector<int> cost(IndexMap::get().num_range());
     for (auto& a : sumindex) {
-      if (a->label() == "c") cost[0] += 1;
-      else if (a->label() == "x") cost[1] += 1;
-      else if (a->label() == "a") cost[2] += 1;
-      else if (a->label() == "ci") cost[3] += 1;
+      const int range = IndexMap::get().space(a->space()).range;
+      if (range >= 0) cost[range] += 1;
       else {
         stringstream ss; ss << "this should not happen - ListTensor::calculate_cost " << a->label() << endl;
         throw logic_error(ss.str());
@@ -267,6 +268,7 @@ shared_ptr<Cost> ListTensor::calculate_cost() const {
 
 
 void ListTensor::reorder() {
+  Stats::Timer timer("reorder");
   // I need to sort list_ first
   vector<shared_ptr<Tensor>> tmp(list_.begin(), list_.end());
   sort(tmp.begin(), tmp.end(), Tensor::comp);
@@ -274,13 +276,16 @@ void ListTensor::reorder() {
   list_ = out;
 
   shared_ptr<Cost> current;
+  long npermutation = 0;
   do {
+    ++npermutation;
     shared_ptr<Cost> cost = calculate_cost();
     if (!current || *cost < *current) {
       out = list_;
       current = cost;
     }
   } while (next_permutation(list_.begin(), list_.end(), Tensor::comp));
+  Stats::get().add("reorder", "permutations", npermutation);
 
   if (out.size() > 1) {
     auto o0 = out.rbegin();
@@ -59,7 +59,7 @@ class ListTensor {
     /// Prints prefactor, if available: scalar, dagger. Finally prints out each tensor in list.
     void print() const;
 
-    /// Combines tensors and removes one from list. To do this, finds active tensor then merges other tensor if other tensor is all_active (has all active indices) but not if active and if not proj. Eg f1 tensor can be absorbed if all active.
+    /// Combines tensors and removes one from list. To do this, finds active tensor then merges other tensor if other tensor is all_active (has all active indices) but not if active and if not proj. Eg f1 tensor can be absorbed if all active. Several such tensors are absorbed in a chain.
     void absorb_all_internal();
     /// Careful, only valid if wave function is not complex. This will reverse braket for gamma and reindex tensors in case of ket, allowing gamma tensors from bra case to be reused.
     void absorb_ket();
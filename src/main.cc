@@ -32,11 +32,19 @@
 #include "forest.h"
 #include "residual.h"
 #include "energy.h"
+#include "stats.h"
+#include "spec.h"
 
 using namespace std;
 using namespace smith;
 
-int main() {
+int main(int argc, char** argv) {
+
+  // equations can instead be read from a specification printed by Prep
+  if (argc > 1) {
+    Spec(argv[1]).generate();
+    return 0;
+  }
 
   string theory="CASPT2";
 
@@ -2634,6 +2642,7 @@ int main() {
   ds.close();
   gs.close();
   gg.close();
+  Stats::get().write(fr->name() + "_stats.json");
   cout << std::endl;
 
   // output
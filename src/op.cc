@@ -67,11 +67,11 @@ void Op::print() const {
 shared_ptr<Operator> Op::copy() const {
   // in the case of two-body operators
   if (c_) {
-    return make_shared<Op>(label_, a_->label(), b_->label(), c_->label(), d_->label(), rho(0)->alpha(), rho(1)->alpha());
+    return arena_shared<Op>(label_, a_->label(), b_->label(), c_->label(), d_->label(), rho(0)->alpha(), rho(1)->alpha());
   } else if (a_)  {
-    return make_shared<Op>(label_, a_->label(), b_->label(), rho(0)->alpha());
+    return arena_shared<Op>(label_, a_->label(), b_->label(), rho(0)->alpha());
   } else {
-    return make_shared<Op>(label_);
+    return arena_shared<Op>(label_);
   }
 }
 
@@ -92,14 +92,26 @@ bool Op::identical(shared_ptr<Operator> o) const {
 
 
 // this function make a possible permutation of indices.
-pair<bool, double> Op::permute(const bool proj) {
+bool Op::permutable(const bool proj) const {
   // if there is active daggered and no-daggered operators, you cannot do this as it changes the expression
-  if ((num_active_nodagger() && num_active_dagger()) || (!proj && (label_ == "" || label_ == "proj")))
+  return !((num_active_nodagger() && num_active_dagger()) || (!proj && (label_ == "" || label_ == "proj")));
+}
+
+
+pair<bool, double> Op::permute(const bool proj) {
+  if (!permutable(proj))
     return make_pair(false, 1.0);
 
+  vector<int> perm = perm_;
+  const bool next = next_permutation(perm.begin(), perm.end());
+  return make_pair(next, arrange(perm));
+}
+
+
+double Op::arrange(const vector<int>& perm) {
   const vector<int> prev = perm_;
   const int size = prev.size();
-  bool next = next_permutation(perm_.begin(), perm_.end());
+  perm_ = perm;
 
   vector<int> map(size);
   vector<int> imap(size); // inverse map
@@ -122,7 +134,7 @@ pair<bool, double> Op::permute(const bool proj) {
     tmp[map[i]*2+1] = *oiter;
   }
 
-  // find sign.
+  // find sign. Only the order among pairs with one active index matters, so the sign does not depend on the path.
   vector<int> act(size);
   oiter = op_.begin();
   for (int i = 0; i != size; ++i, ++oiter) {
@@ -144,7 +156,7 @@ pair<bool, double> Op::permute(const bool proj) {
   oiter = op_.begin();
   for (auto t = tmp.begin(); t != tmp.end(); ++t, ++oiter) *oiter = *t;
 
-  return make_pair(next, out);
+  return out;
 }
 
 
@@ -72,6 +72,10 @@ class Op : public Operator {
 
     /// Makes a possible permutation of indices. Cannot permute if there are active daggered and no-daggered operators or if label is proj.
     std::pair<bool, double> permute(const bool proj) override;
+    /// Returns if permute can change this operator.
+    bool permutable(const bool proj) const override;
+    /// Moves the pairs of indices so that perm_ becomes perm in one step. Returns the sign accumulated by permute along the way.
+    double arrange(const std::vector<int>& perm) override;
 
     /// Checks label, and first two operator tuple fields (index and operator contraction info). **NOTE** that spin info (third op field) is not checked.
     bool identical(std::shared_ptr<Operator> o) const override;
@@ -31,25 +31,25 @@ using namespace std;
 using namespace smith;
 
 Operator::Operator(const string& ta, const string& tb, const bool alpha)
-  : a_(make_shared<Index>(ta,true)), b_(make_shared<Index>(tb,false)) {
+  : a_(arena_shared<Index>(ta,true)), b_(arena_shared<Index>(tb,false)) {
   op_.push_back(make_tuple(&a_, ta!="x"?0:2, 0)); // index, dagger, spin
   op_.push_back(make_tuple(&b_, tb!="x"?0:2, 0));
-  rho_.push_back(make_shared<Spin>(alpha));
+  rho_.push_back(arena_shared<Spin>(alpha));
 
   perm_.push_back(0);
 }
 
 
 Operator::Operator(const string& ta, const string& tb, const string& tc, const string& td, const bool alpha1, const bool alpha2)
-  : a_(make_shared<Index>(ta,true)), b_(make_shared<Index>(tb,true)), c_(make_shared<Index>(tc,false)), d_(make_shared<Index>(td,false)) {
+  : a_(arena_shared<Index>(ta,true)), b_(arena_shared<Index>(tb,true)), c_(arena_shared<Index>(tc,false)), d_(arena_shared<Index>(td,false)) {
   // accept aa,ii and rearrange it to ai,ai
   op_.push_back(make_tuple(&a_, ta!="x"?0:2, 0)); // index, no-active/active, spin
   op_.push_back(make_tuple(&d_, td!="x"?0:2, 0)); // from historical reasons, it is 0 and 2. -1 when contracted.
   op_.push_back(make_tuple(&b_, tb!="x"?0:2, 1));
   op_.push_back(make_tuple(&c_, tc!="x"?0:2, 1));
 
-  rho_.push_back(make_shared<Spin>(alpha1));
-  rho_.push_back(make_shared<Spin>(alpha2));
+  rho_.push_back(arena_shared<Spin>(alpha1));
+  rho_.push_back(arena_shared<Spin>(alpha2));
 
   perm_.push_back(0);
   perm_.push_back(1);
@@ -106,16 +106,16 @@ bool Operator::general() const {
 int Operator::num_general() const {
   int out = 0;
   for (auto& i : op_)
-    if((*get<0>(i))->label() ==  "g") ++out;
+    if((*get<0>(i))->space() == IndexMap::general) ++out;
   return out;
 }
 
 
 void Operator::mutate_general(int& in) {
   for (auto& i : op_) {
-    if ((*get<0>(i))->label() ==  "g") {
+    if ((*get<0>(i))->space() == IndexMap::general) {
       if (in & 1) {
-        (*get<0>(i))->set_label("x");
+        (*get<0>(i))->set_space(IndexMap::active);
         get<1>(i) += 2;
       }
       in >>= 1;  // decrease in by one bit
@@ -132,105 +132,44 @@ bool Operator::contracted() const {
 }
 
 
-void Operator::refresh_indices(map<shared_ptr<const Index>, int>& dict,
-                               map<shared_ptr<const Index>, int>& done,
-                               map<shared_ptr<Spin>, int>& spin) {
+void Operator::refresh_indices(vector<pair<const Index*, int>>& dict,
+                               vector<pair<const Index*, int>>& done,
+                               vector<const Spin*>& spin, const bool renumber) {
   //
   // Note: seperate labeling for those still in the operators and those
   //       already contracted. This is to make it easy to get the minus sign in the
   //       Wick theorem evaluator.
   //
+  auto registered = [](const vector<pair<const Index*, int>>& v, const Index* i) {
+    return find_if(v.begin(), v.end(), [&i](const pair<const Index*, int>& p) { return p.first == i; }) != v.end();
+  };
   for (auto& i : op_) {
+    const Index* index = get<0>(i)->get();
     // if this is not still contracted
     if (get<1>(i) != -1) {
-      auto iter = dict.find(*get<0>(i));
-      if (iter == dict.end()) {
+      if (!registered(dict, index)) {
         const int c = dict.size();
-        dict.emplace(*get<0>(i), c);
-        (*get<0>(i))->set_num(c);
+        dict.push_back(make_pair(index, c));
+        if (renumber) (*get<0>(i))->set_num(c);
       }
     // if this is already contracted, we use negative values (does not have to be, though - just for print out)
     } else {
-      auto iter = done.find(*get<0>(i));
-      if (iter == done.end()) {
+      if (!registered(done, index)) {
         const int c = done.size();
-        done.emplace(*get<0>(i), -c-1);
-        (*get<0>(i))->set_num(-c-1);
+        done.push_back(make_pair(index, -c-1));
+        if (renumber) (*get<0>(i))->set_num(-c-1);
       }
     }
 
-    auto ster = spin.find(rho(get<2>(i)));
     if (get<1>(i) != -1) {
-      if (ster == spin.end()) {
+      if (find(spin.begin(), spin.end(), rho(get<2>(i)).get()) == spin.end()) {
         const int c = spin.size();
-        spin.emplace(rho(get<2>(i)), c);
-        rho(get<2>(i))->set_num(c);
+        spin.push_back(rho(get<2>(i)).get());
+        if (renumber) rho(get<2>(i))->set_num(c);
       }
     }
 
     // set all the spins into operators
-    (*get<0>(i))->set_spin(rho(get<2>(i)));
+    if (renumber) (*get<0>(i))->set_spin(rho(get<2>(i)));
   }
 }
-
-
-pair<shared_ptr<Index>*, shared_ptr<Spin>* > Operator::first_dagger_noactive() {
-  pair<shared_ptr<Index>*, shared_ptr<Spin>* > out;
-  auto i = op_.begin();
-  for (; i != op_.end(); ++i) {
-    if (get<1>(*i)==0 && (*get<0>(*i))->dagger()) { // "x" is active orbitals = 2
-      out = make_pair(get<0>(*i), rho_ptr(get<2>(*i)));
-      break;
-    }
-  }
-  if (out.first) get<1>(*i) = -1;
-  return out;
-}
-
-
-shared_ptr<Index>* Operator::survive(shared_ptr<Index>* a, shared_ptr<Index>* b) {
-  string alab = (*a)->label();
-  string blab = (*b)->label();
-  if (alab == blab) return a;
-  else if (alab == "g" && blab != "g") return b;
-  else if (alab != "g" && blab == "g") return a;
-  else throw logic_error("A strange thing happened in Op::survive");
-};
-
-
-tuple<double, shared_ptr<Spin>, shared_ptr<Spin>>
-     Operator::contract(pair<shared_ptr<Index>*, shared_ptr<Spin>* >& dat, const int skip) {
-  int cnt = 0;
-  auto i = op_.begin();
-  double fac = 0.0;
-  shared_ptr<Spin> a, b;
-  for (; i != op_.end(); ++i) {
-    if (get<1>(*i)!=0 || (*get<0>(*i))->dagger()) continue;
-    if (contractable((*get<0>(*i))->label(), (*dat.first)->label())) {
-      if (cnt == skip) {
-        const int n1 = (*dat.first)->num();
-        const int n2 = (*get<0>(*i))->num();
-        if (n1 == n2) throw logic_error("Should not happen. Op::contract");
-        fac = (abs(n2-n1) & 1) ? 1.0 : -1.0;
-
-        *get<0>(*i) = *survive(get<0>(*i), dat.first);
-        *dat.first = *get<0>(*i);
-        // if closing a spin loop, multiply 2
-        fac *= (*dat.second == rho(get<2>(*i)) && !(*dat.second)->alpha()) ? fac2 : 1.0;
-        a = *dat.second;
-        b = rho(get<2>(*i));
-        set_rho(get<2>(*i), *dat.second);
-
-        break;
-      } else {
-        ++cnt;
-      }
-    }
-  }
-  get<1>(*i) = -1;
-  return make_tuple(fac, a, b);
-}
-
-
-
-
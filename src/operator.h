@@ -79,6 +79,10 @@ class Operator {
     virtual void print() const = 0; // pure virtual function to force derived classes to define these members.
     /// pure virtual permute.
     virtual std::pair<bool, double> permute(const bool proj) = 0;
+    /// pure virtual check if permute can change this operator.
+    virtual bool permutable(const bool proj) const = 0;
+    /// pure virtual rearrangement of pairs of indices to a given permutation count. Returns the sign.
+    virtual double arrange(const std::vector<int>& perm) = 0;
     /// pure virtual comparison.
     virtual bool identical(std::shared_ptr<Operator> o) const = 0;
     /// pure virtual copy operatory pointer.
@@ -94,6 +98,8 @@ class Operator {
     bool general() const;
     /// Counts number of general operators.
     int num_general() const;
+    /// Returns permutation count, i.e., the original position of the pair of indices at each position.
+    const std::vector<int>& perm() const { return perm_; }
 
     /// Counts number of nondaggered active operators.
     int num_active_nodagger() const;
@@ -124,23 +130,11 @@ class Operator {
     std::list<std::tuple<std::shared_ptr<Index>*, int, int>>& op() { return op_; }
 
 
-    /// CAUTION:: this function returns the first daggered operator (not an active operator, nor already contracted) **AND** deletes the corresponding entry from this->op_, by marking as contracted.
-    std::pair<std::shared_ptr<Index>*, std::shared_ptr<Spin>* > first_dagger_noactive();
-
-    /// Perform a contraction, skipping first "skip" from equation. Returns the factor, new, and old spin. Called from Diagram::reduce_one_noactive.
-    std::tuple<double, std::shared_ptr<Spin>, std::shared_ptr<Spin>>
-      contract(std::pair<std::shared_ptr<Index>*, std::shared_ptr<Spin>* >& dat, const int skip);
-
-    /// Returns if you can contract two labels. Labels (type) must be same or one must be of type general in order to do contraction. Dagger info is not checked here but in contract function.
-    bool contractable(std::string a, std::string b) { return a == b || a == "g" || b == "g"; };
-
-    /// Returns which index to be kept when contraction is performed.
-    std::shared_ptr<Index>* survive(std::shared_ptr<Index>* a, std::shared_ptr<Index>* b);
-
     /// Function to update Index and Spin and check if contracted.  Should be called from Diagram objects.
-    void refresh_indices(std::map<std::shared_ptr<const Index>, int>& dict,
-                         std::map<std::shared_ptr<const Index>, int>& done,
-                         std::map<std::shared_ptr<Spin>, int>& spin);
+    /// Indices and spins are registered in the arguments in the order of appearance. If renumber is false, they are only registered.
+    void refresh_indices(std::vector<std::pair<const Index*, int>>& dict,
+                         std::vector<std::pair<const Index*, int>>& done,
+                         std::vector<const Spin*>& spin, const bool renumber = true);
 
 
 };
@@ -24,6 +24,8 @@
 
 
 #include <iomanip>
+#include <set>
+#include <sstream>
 #include "constants.h"
 #include "active.h"
 
@@ -65,83 +67,58 @@ bool RDM::reduce_done(const list<int>& done) const {
 
 
 void RDM::sort() {
+  // Indices are aligned as 0+ 0 1+ 1 2+ 2... in one go. Each pair takes the place of its second index in the original order,
+  // and alpha pairs are then moved to the front in reverse order. The sign is the parity of the permutation.
+  const vector<shared_ptr<const Index>> in(index_.begin(), index_.end());
+  const int size = in.size();
+
+  // positions of the daggered and non-daggered index of each spin, in the order the pairs are completed
+  vector<pair<int,int>> pairs;
+  map<shared_ptr<Spin>, int> open;
+  for (int n = 0; n != size; ++n) {
+    auto iter = open.find(in[n]->spin());
+    if (iter == open.end()) {
+      open.insert(make_pair(in[n]->spin(), n));
+      continue;
+    }
+    const int m = iter->second;
+    if (in[m]->dagger() == in[n]->dagger()) throw logic_error("RDM::sort()");
+    pairs.push_back(in[m]->dagger() ? make_pair(m, n) : make_pair(n, m));
+    open.erase(iter);
+  }
+  if (!open.empty()) {
+    for (auto& i : in) i->print();
+    throw logic_error("RDM::sort()");
+  }
 
-  // of course this is not the fastest code, but I am fine.
-
-  // first we align indices so that
-  // 0+ 0 1+ 1 2+ 2...
-  // actually this might be better for implementation.
-  vector<shared_ptr<Spin>> done_spin;
-  while (!done()) {
-
-    list<shared_ptr<const Index>> buf;
-    auto i = index_.begin();
-    // continue to spin which is not processed
-    for (; i != index_.end(); ++i) {
-      if (find(done_spin.begin(), done_spin.end(), (*i)->spin()) != done_spin.end()) {
-        buf.push_back(*i);
-      } else {
-        break;
-      }
+  vector<int> order;
+  order.reserve(size);
+  for (auto i = pairs.rbegin(); i != pairs.rend(); ++i)
+    if (in[i->first]->spin()->alpha()) {
+      order.push_back(i->first);
+      order.push_back(i->second);
     }
-    {
-      shared_ptr<Spin> cs = (*i)->spin();
-      const bool dagger = (*i)->dagger();
-      auto j = i;
-      int cnt = 0;
-      bool found = false;
-
-      if (dagger) {
-        // if dagger, move it to right before the nondagger of the same spin
-        for (++j; j != index_.end(); ++j) {
-          if ((*j)->spin() == cs) {
-            buf.push_back(*i);
-            buf.push_back(*j);
-            assert(!(*j)->dagger());
-            found = true;
-          } else {
-            buf.push_back(*j);
-            if (!found) ++cnt;
-          }
-        }
-      } else {
-        // if nodagger, move it to right after the dagger of the same spin
-        for (++j; j != index_.end(); ++j) {
-          if ((*j)->spin() == cs) {
-            buf.push_back(*j);
-            assert((*j)->dagger());
-            buf.push_back(*i);
-            ++cnt;
-            found = true;
-          } else {
-            buf.push_back(*j);
-            if (!found) ++cnt;
-          }
-        }
-      }
-      fac_ *= (cnt%2 == 1) ? -1 : 1;
-      done_spin.push_back(cs);
+  for (auto& i : pairs)
+    if (!in[i.first]->spin()->alpha()) {
+      order.push_back(i.first);
+      order.push_back(i.second);
     }
-    if (index_.size() != buf.size()) {
-      for (auto z = buf.begin(); z != buf.end(); ++z) (*z)->print();
-      throw logic_error("RDM::sort()");
+
+  // parity from the cycle decomposition
+  int transposition = 0;
+  vector<bool> visited(size, false);
+  for (int n = 0; n != size; ++n) {
+    if (visited[n]) continue;
+    for (int m = n; !visited[m]; m = order[m]) {
+      visited[m] = true;
+      ++transposition;
     }
-    index_ = buf;
+    --transposition;
   }
+  if (transposition & 1) fac_ *= -1;
 
-  // move alpha indices to the front
-  list<shared_ptr<const Index>> buf = index_;
   index_.clear();
-  for (auto ii = buf.begin(); ii != buf.end(); ) {
-    if (!(*ii)->spin()->alpha()) {
-      index_.push_back(*ii++);
-      index_.push_back(*ii++);
-    } else {
-      index_.push_front(*++ii);
-      index_.push_front(*--ii);
-      ++ii; ++ii;
-    }
-  }
+  for (auto& i : order) index_.push_back(in[i]);
 }
 
 
@@ -171,6 +148,11 @@ bool RDM::done() const {
 }
 
 
+bool RDM::cumulant() const {
+  return CumulantRDM4 && rank() == 4 && !bra_ && !ket_ && !index_.front()->spin()->alpha();
+}
+
+
 bool RDM::operator==(const RDM& o) const {
   bool out = true;
   // compare all rdms of active objects
@@ -189,6 +171,27 @@ bool RDM::operator==(const RDM& o) const {
 }
 
 
+string RDM::shape() const {
+  set<pair<int,int>> index;
+  for (auto i = index_.begin(); i != index_.end(); ++i) {
+    const int a = (*i++)->num();
+    if (!index.insert(make_pair(a, (*i)->num())).second) return "";
+  }
+  set<pair<int,int>> delta;
+  for (auto& i : delta_) {
+    const int a = i.first->num();
+    const int b = i.second->num();
+    if (!delta.insert(make_pair(min(a, b), max(a, b))).second) return "";
+  }
+  stringstream ss;
+  ss << bra_ << ket_ << index_.size() << ":";
+  for (auto& i : index) ss << i.first << "," << i.second << " ";
+  ss << ":";
+  for (auto& i : delta) ss << i.first << "," << i.second << " ";
+  return ss.str();
+}
+
+
 bool RDM::identical(shared_ptr<const RDM> o) const {
   bool out = true;
   out &= bra_ == o->bra();
@@ -38,7 +38,7 @@ class RDM {
     /// Operators that constitute RDM.
     std::list<std::shared_ptr<const Index>> index_;
     /// Kronecker's delta, map with two index pointers.
-    std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>> delta_;
+    std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>, IndexOrder> delta_;
 
     /// Inherits bra from diagram, done in active ctor.
     bool bra_;
@@ -71,7 +71,7 @@ class RDM {
   public:
     /// Make RDM object from list of indices, delta indices and factor.
     RDM(const std::list<std::shared_ptr<const Index>>& in,
-        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& in2, std::pair<bool, bool> braket,
+        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>, IndexOrder>& in2, std::pair<bool, bool> braket,
         const double& f = 1.0)
       : fac_(f), index_(in), delta_(in2), bra_(braket.first), ket_(braket.second) { }
     virtual ~RDM() { }
@@ -106,9 +106,9 @@ class RDM {
     const std::list<std::shared_ptr<const Index>>& index() const { return index_; }
 
     /// Returns a const reference of delta_.
-    const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& delta() const { return delta_; }
+    const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>, IndexOrder>& delta() const { return delta_; }
     /// Returns a reference of delta_.
-    std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& delta() { return delta_; }
+    std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>, IndexOrder>& delta() { return delta_; }
 
     /// Returns if this is in the final form..ie aligned as a0+ a0 a1+ a1..Member function located in active.cc
     bool done() const;
@@ -117,10 +117,14 @@ class RDM {
 
     /// Returns an integer representing rdm rank value, ie (index size)/2
     int rank() const { assert(index_.size()%2 == 0); return index_.size()/2; }
+    /// Returns if this is a 4-RDM of the reference that is rebuilt from rdm1-rdm3 by the cumulant expansion in the generated code (see CumulantRDM4 in constants.h).
+    bool cumulant() const;
 
     /// Compares for equivalency based on prefactor, indices, delta, and braket.
     bool operator==(const RDM& o) const;
     bool identical(std::shared_ptr<const RDM> o) const;
+    /// Returns a string that is the same for identical() RDMs, used as a hash key. Empty if a pair of numbers appears twice, as identical() only checks inclusion.
+    std::string shape() const;
 
     // virtual public functions
     /// Application of Wick's theorem and is controlled by const Index::num_. See active.cc. One index is going to be annihilated. done is updated inside the function.
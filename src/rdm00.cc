@@ -43,7 +43,7 @@ shared_ptr<RDM> RDM00::copy() const {
     if (dict.find(o) == dict.end()) {
       (*j)->set_spin(o);
     } else {
-      auto s = make_shared<Spin>(o->alpha());
+      auto s = arena_shared<Spin>(o->alpha());
       s->set_num(o->num());
       dict.insert(make_pair(o,s));
       (*j)->set_spin(s);
@@ -51,7 +51,7 @@ shared_ptr<RDM> RDM00::copy() const {
   }
 
   // lastly clone all the delta functions
-  map<shared_ptr<const Index>, shared_ptr<const Index>> d;
+  map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder> d;
   for (auto& i : delta_) d.insert(make_pair(i.first->clone(), i.second->clone()));
 
   list<shared_ptr<const Index>> inc;
@@ -174,7 +174,7 @@ string RDM00::generate_not_merged(string indent, const string tag, const list<sh
     map<string, string> inlab;
     map_in_tensors(in_tensors, inlab);
 
-    tt << make_get_block(indent, "i0", inlab[rlab], index_);
+    tt << (cumulant() ? make_cumulant_block(indent, "i0", inlab, index_) : make_get_block(indent, "i0", inlab[rlab], index_));
 
     // loops over delta indices
     tt << make_sort_loops(itag, indent, index, close);
@@ -215,7 +215,7 @@ string RDM00::generate_not_merged(string indent, const string tag, const list<sh
         zz << "a";
       zz << "rdm" << rank();
       string rlab = zz.str();
-      tt << make_get_block(indent, "i0", inlab[rlab], index_);
+      tt << (cumulant() ? make_cumulant_block(indent, "i0", inlab, index_) : make_get_block(indent, "i0", inlab[rlab], index_));
     }
 
     // do sort_indices here
@@ -292,7 +292,9 @@ string RDM00::generate_merged(string indent, const string tag, const list<shared
     zz << "a";
 
   zz << "rdm" << rank();
-  if (rank() == 4)
+  // the 4RDM is contracted a priori with the merged tensor, unless it is rebuilt from its cumulants or several tensors are merged
+  const bool contracted = rank() == 4 && find(in_tensors.begin(), in_tensors.end(), zz.str() + "f") != in_tensors.end();
+  if (contracted)
     zz << "f";
   string rlab = zz.str();
 
@@ -316,8 +318,8 @@ string RDM00::generate_merged(string indent, const string tag, const list<shared
   }
 
 
-  // if this is 4RDM
-  if (rank() == 4) {
+  // if this is 4RDM, which is contracted with the merged tensor a priori
+  if (contracted) {
     assert(delta_.empty());
     // remove merge index from rindex, dindex
     list<list<shared_ptr<const Index>>::iterator> rm, rm2;
@@ -343,7 +345,7 @@ string RDM00::generate_merged(string indent, const string tag, const list<shared
     // mulitiply data and merge on the fly
     tt << multiply_merge(itag, indent, list<shared_ptr<const Index>>(), rindex);
   } else if (!use_blas) {
-    tt << make_get_block(indent, "i0", inlab[rlab], rindex);
+    tt << (cumulant() ? make_cumulant_block(indent, "i0", inlab, rindex) : make_get_block(indent, "i0", inlab[rlab], rindex));
     // loops for index and merged
     tt << make_merged_loops(indent, itag, close, dindex);
     // make odata part of summation for target
@@ -544,6 +546,19 @@ string RDM00::make_get_block(string indent, string tag, string lbl, const list<s
 }
 
 
+string RDM00::make_cumulant_block(string indent, string tag, map<string,string>& inlab, const list<shared_ptr<const Index>>& index) {
+  assert(index.size() == 8);
+  stringstream tt;
+  tt << indent << "std::unique_ptr<" << DataType << "[]> " << tag << "data = CumulantBlock({{" << inlab["rdm1"] << ", " << inlab["rdm2"] << ", " << inlab["rdm3"] << "}}, {{";
+  for (auto i = index.rbegin(); i != index.rend(); ++i) {
+    if (i != index.rbegin()) tt << ", ";
+    tt << (*i)->str_gen();
+  }
+  tt << "}}).get_block();" << endl;
+  return tt.str();
+}
+
+
 string RDM00::make_blas_multiply(string dindent, const list<shared_ptr<const Index>>& loop, const list<shared_ptr<const Index>>& index) {
   stringstream tt;
 
@@ -36,6 +36,8 @@ class RDM00 : public RDM {
 
     /// Generate get block - source data to be added to target (move block).
     std::string make_get_block(std::string indent, std::string tag, std::string lbl, const std::list<std::shared_ptr<const Index>>& index);
+    /// Generate a block of a 4-RDM rebuilt from rdm1-rdm3 (see Cumulant), used in place of make_get_block when cumulant() is true.
+    std::string make_cumulant_block(std::string indent, std::string tag, std::map<std::string,std::string>& inlab, const std::list<std::shared_ptr<const Index>>& index);
     /// Generates RDM and merged (fock) tensor multipication.
     std::string multiply_merge(const std::string itag, std::string& indent,  const std::list<std::shared_ptr<const Index>>& merged, const std::list<std::shared_ptr<const Index>>& index);
     /// Generate sort_indices which makes array. This version has no addition (or factor multiplication-0111).
@@ -72,7 +74,7 @@ class RDM00 : public RDM {
   public:
     /// Make RDM object from list of indices, delta indices and factor.
     RDM00(const std::list<std::shared_ptr<const Index>>& in,
-        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>>& in2, std::pair<bool, bool> braket,
+        const std::map<std::shared_ptr<const Index>, std::shared_ptr<const Index>, IndexOrder>& in2, std::pair<bool, bool> braket,
         const double& f = 1.0)
       : RDM(in, in2, braket, f) { }
     virtual ~RDM00() { }
@@ -43,7 +43,7 @@ shared_ptr<RDM> RDMI0::copy() const {
     if (dict.find(o) == dict.end()) {
       (*j)->set_spin(o);
     } else {
-      auto s = make_shared<Spin>(/*TODO alpha*/false);
+      auto s = arena_shared<Spin>(/*TODO alpha*/false);
       s->set_num(o->num());
       dict.insert(make_pair(o,s));
       (*j)->set_spin(s);
@@ -51,7 +51,7 @@ shared_ptr<RDM> RDMI0::copy() const {
   }
 
   // lastly clone all the delta functions
-  map<shared_ptr<const Index>, shared_ptr<const Index>> d;
+  map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder> d;
   for (auto& i : delta_) d.insert(make_pair(i.first->clone(), i.second->clone()));
 
   list<shared_ptr<const Index>> inc;
@@ -66,7 +66,7 @@ shared_ptr<RDM> RDMI0::copy() const {
 list<shared_ptr<const Index>> RDMI0::conjugate() {
   list<shared_ptr<const Index>> out;
   for (auto i = index_.rbegin(); i != index_.rend(); ++i) {
-    shared_ptr<const Index> tmp = make_shared<const Index>((**i),(*i)->dagger());
+    shared_ptr<const Index> tmp = arena_shared<const Index>((**i),(*i)->dagger());
     out.push_back(tmp);
   }
   return out;
@@ -164,7 +164,7 @@ string RDMI0::generate_not_merged_sources(string indent, const string tag, const
 
   list<shared_ptr<const Index>> dindex = index;
   list<shared_ptr<const Index>> ci_index;
-  for (auto& i : index) if (i->label() == "ci") ci_index.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) ci_index.push_back(i);
 
   list<shared_ptr<const Index>> delta_index ;
   // first delta loops for blocks
@@ -182,7 +182,7 @@ string RDMI0::generate_not_merged_sources(string indent, const string tag, const
     }
     if (!found) rindex.push_back(i);
   }
-  for (auto& i : index) if (i->label() == "ci") rindex.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) rindex.push_back(i);
 
   // now do the sort
   vector<string> close;
@@ -224,7 +224,7 @@ string RDMI0::generate_not_merged_sources(string indent, const string tag, const
         for (auto riter = rindex.rbegin(); riter != rindex.rend(); ++riter) {
           int inum = (*riter)->num();
           for (auto& d : delta_)
-            if ((*riter)->label() != "ci" && d.first->num() == inum) inum = d.second->num();
+            if ((*riter)->space() != IndexMap::ci && d.first->num() == inum) inum = d.second->num();
           const string tmp = "+" + (*riter)->str_gen() + ".size()*(";
           dd << itag << (*riter)->label() << inum << (riter != --rindex.rend() ? tmp : "");
         }
@@ -345,7 +345,7 @@ string RDMI0::generate_merged_sources(string indent, const string tag, const lis
     }
     if (!found) rindex.push_back(i);
   }
-  for (auto& i : index) if (i->label() == "ci") rindex.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) rindex.push_back(i);
 
   // make map of in_tensors
   map<string, string> inlab;
@@ -420,7 +420,7 @@ string RDMI0::generate_not_merged(string indent, const string tag, const list<sh
 
   list<shared_ptr<const Index>> dindex = index;
   list<shared_ptr<const Index>> ci_index;
-  for (auto& i : index) if (i->label() == "ci") ci_index.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) ci_index.push_back(i);
 
   list<shared_ptr<const Index>> delta_index ;
   // first delta loops for blocks
@@ -438,7 +438,7 @@ string RDMI0::generate_not_merged(string indent, const string tag, const list<sh
     }
     if (!found) rindex.push_back(i);
   }
-  for (auto& i : index) if (i->label() == "ci") rindex.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) rindex.push_back(i);
 
   // now do the sort
   vector<string> close;
@@ -490,7 +490,7 @@ string RDMI0::generate_not_merged(string indent, const string tag, const list<sh
         for (auto riter = rindex.rbegin(); riter != rindex.rend(); ++riter) {
           int inum = (*riter)->num();
           for (auto& d : delta_)
-            if ((*riter)->label() != "ci" && d.first->num() == inum) inum = d.second->num();
+            if ((*riter)->space() != IndexMap::ci && d.first->num() == inum) inum = d.second->num();
           const string tmp = "+" + (*riter)->str_gen() + ".size()*(";
           dd << itag << (*riter)->label() << inum << (riter != --rindex.rend() ? tmp : "");
         }
@@ -610,7 +610,7 @@ string RDMI0::generate_merged(string indent, const string tag, const list<shared
     }
     if (!found) rindex.push_back(i);
   }
-  for (auto& i : index) if (i->label() == "ci") rindex.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) rindex.push_back(i);
 
   // if this is 4RDM derivative
   if (rank() == 4) {
@@ -978,7 +978,7 @@ string RDMI0::make_merged_loops(string& indent, const string itag, vector<string
   // add ci index
   if (!overwrite)
     for (auto& i : index)
-      if (i->label() == "ci") loop.push_back(i);
+      if (i->space() == IndexMap::ci) loop.push_back(i);
 
   // generate loops
   for (auto& i : loop) {
@@ -994,7 +994,7 @@ string RDMI0::make_merged_loops(string& indent, const string itag, vector<string
 string RDMI0::multiply_merge_sources(const string itag, string& indent, const list<shared_ptr<const Index>>& merged, const list<shared_ptr<const Index>>& index) {
   stringstream tt;
   list<shared_ptr<const Index>>  ci_index;
-  for (auto& i : index) if (i->label() == "ci") ci_index.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) ci_index.push_back(i);
 
   if (rank() == 0) {
     tt << indent << "o" << rank() << "data[0]";
@@ -1007,7 +1007,7 @@ string RDMI0::multiply_merge_sources(const string itag, string& indent, const li
     for (auto riter = index.rbegin(); riter != index.rend(); ++riter) {
       int inum = (*riter)->num();
       for (auto& d : delta_)
-        if ((*riter)->label() != "ci" && d.first->num() == inum) inum = d.second->num();
+        if ((*riter)->space() != IndexMap::ci && d.first->num() == inum) inum = d.second->num();
       const string tmp = "+" + (*riter)->str_gen() + ".size()*(";
       tt << itag <<  (*riter)->label() << inum << (riter != --index.rend() ? tmp : "");
     }
@@ -1027,7 +1027,7 @@ string RDMI0::multiply_merge_sources(const string itag, string& indent, const li
 string RDMI0::multiply_merge(const string itag, string& indent, const list<shared_ptr<const Index>>& merged, const list<shared_ptr<const Index>>& index) {
   stringstream tt;
   list<shared_ptr<const Index>>  ci_index;
-  for (auto& i : index) if (i->label() == "ci") ci_index.push_back(i);
+  for (auto& i : index) if (i->space() == IndexMap::ci) ci_index.push_back(i);
 
   if (rank() == 0) {
     tt << "  += " << setprecision(1) << fixed << factor();
@@ -1039,7 +1039,7 @@ string RDMI0::multiply_merge(const string itag, string& indent, const list<share
     for (auto riter = index.rbegin(); riter != index.rend(); ++riter) {
       int inum = (*riter)->num();
       for (auto& d : delta_)
-        if ((*riter)->label() != "ci" && d.first->num() == inum) inum = d.second->num();
+        if ((*riter)->space() != IndexMap::ci && d.first->num() == inum) inum = d.second->num();
       const string tmp = "+" + (*riter)->str_gen() + ".size()*(";
       tt << itag <<  (*riter)->label() << inum << (riter != --index.rend() ? tmp : "");
     }
@@ -1099,7 +1099,7 @@ string RDMI0::make_odata_sources(const string itag, string& indent, const list<s
     for (auto ri = index.rbegin(); ri != index.rend(); ++ri) {
       int inum = (*ri)->num();
       for (auto& d : delta_)
-        if ((*ri)->label() != "ci" && d.first->num() == inum) inum = d.second->num();
+        if ((*ri)->space() != IndexMap::ci && d.first->num() == inum) inum = d.second->num();
       const string tmp = "+" + (*ri)->str_gen() + ".size()*(";
       tt << itag <<  (*ri)->label() << inum << (ri != --index.rend() ? tmp : "");
     }
@@ -1123,7 +1123,7 @@ string RDMI0::make_odata(const string itag, string& indent, const list<shared_pt
     for (auto ri = index.rbegin(); ri != index.rend(); ++ri) {
       int inum = (*ri)->num();
       for (auto& d : delta_)
-        if ((*ri)->label() != "ci" && d.first->num() == inum) inum = d.second->num();
+        if ((*ri)->space() != IndexMap::ci && d.first->num() == inum) inum = d.second->num();
       const string tmp = "+" + (*ri)->str_gen() + ".size()*(";
       tt << itag <<  (*ri)->label() << inum << (ri != --index.rend() ? tmp : "");
     }
@@ -1145,7 +1145,7 @@ string RDMI0::make_sort_loops(const string itag, string& indent, const list<shar
     bool found = false;
     for (auto& d : delta_)
       // do not want to compare number of ci index
-      if (d.first->num() == inum && i->label() != "ci") found = true;
+      if (d.first->num() == inum && i->space() != IndexMap::ci) found = true;
     if (!found) {
       tt << indent << "for (int " << itag << i->str_gen() << " = 0; " << itag << i->str_gen() << " != " << i->str_gen() << ".size(); ++" << itag << i->str_gen() << ") {" << endl;
       close.push_back(indent + "}");
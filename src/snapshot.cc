@@ -0,0 +1,335 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: snapshot.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+using namespace std;
+using namespace smith;
+
+/// Identifies snapshot files. The last character is the version of the format.
+static const char magic__[8] = {'S', 'M', 'I', 'T', 'H', '3', 'S', '1'};
+
+namespace {
+
+/// Appends values to a buffer in the native binary representation.
+class Writer {
+  protected:
+    std::vector<char> buf_;
+  public:
+    template<typename T>
+    void put(const T& a) { const char* p = reinterpret_cast<const char*>(&a); buf_.insert(buf_.end(), p, p+sizeof(T)); }
+    void put(const std::string& a) { put<int32_t>(a.size()); buf_.insert(buf_.end(), a.begin(), a.end()); }
+    const std::vector<char>& buf() const { return buf_; }
+};
+
+/// Reads values written by Writer from a memory block.
+class Reader {
+  protected:
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    void check(const size_t n) const { if (n > size_ - pos_) throw runtime_error("Snapshot: file is truncated"); }
+  public:
+    Reader(const char* d, const size_t s) : data_(d), size_(s), pos_(0) { }
+    template<typename T>
+    T get() { check(sizeof(T)); T out; memcpy(&out, data_+pos_, sizeof(T)); pos_ += sizeof(T); return out; }
+    std::string get_string() { const int32_t n = get<int32_t>(); check(n); string out(data_+pos_, n); pos_ += n; return out; }
+    /// Reads an id into a table of size n; -1 is allowed if null is true.
+    int get_id(const size_t n, const bool null = false) {
+      const int32_t i = get<int32_t>();
+      if (i < (null ? -1 : 0) || i >= static_cast<int32_t>(n)) throw runtime_error("Snapshot: broken file");
+      return i;
+    }
+    bool done() const { return pos_ == size_; }
+};
+
+/// Maps a file to memory during its lifetime.
+class Mapping {
+  protected:
+    void* data_;
+    size_t size_;
+  public:
+    Mapping(const string& file) : data_(nullptr), size_(0) {
+      const int fd = open(file.c_str(), O_RDONLY);
+      if (fd < 0) throw runtime_error("Snapshot: cannot open " + file);
+      struct stat st;
+      if (fstat(fd, &st) == 0) size_ = st.st_size;
+      if (size_ > 0) data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (size_ == 0 || data_ == MAP_FAILED) throw runtime_error("Snapshot: cannot map " + file);
+    }
+    ~Mapping() { munmap(data_, size_); }
+    const char* data() const { return static_cast<const char*>(data_); }
+    size_t size() const { return size_; }
+};
+
+}
+
+
+void Snapshot::write(const string& file, shared_ptr<Equation> eq) {
+  const list<shared_ptr<Diagram>> diagram = eq->diagram();
+
+  // all the indices in the order of construction, which orders the maps keyed on them (see IndexOrder)
+  vector<shared_ptr<const Index>> index;
+  unordered_map<const Index*, int> index_id;
+  auto add_index = [&index, &index_id](const shared_ptr<const Index>& i) {
+    if (index_id.insert(make_pair(i.get(), 0)).second) index.push_back(i);
+  };
+  for (auto& d : diagram) {
+    for (auto& o : d->op())
+      for (auto& s : o->op()) add_index(*get<0>(s));
+    if (d->rdm())
+      for (auto& r : d->rdm()->rdm()) {
+        for (auto& i : r->index()) add_index(i);
+        for (auto& i : r->delta()) {
+          add_index(i.first);
+          add_index(i.second);
+        }
+      }
+  }
+  sort(index.begin(), index.end(), IndexOrder());
+  for (size_t k = 0; k != index.size(); ++k) index_id[index[k].get()] = k;
+
+  // cores and spins, which can be shared among indices and operators
+  vector<shared_ptr<const Index_Core>> core;
+  unordered_map<const Index_Core*, int> core_id;
+  vector<shared_ptr<const Spin>> spin;
+  unordered_map<const Spin*, int> spin_id;
+  auto add_spin = [&spin, &spin_id](const shared_ptr<const Spin>& s) {
+    if (spin_id.insert(make_pair(s.get(), spin.size())).second) spin.push_back(s);
+  };
+  for (auto& i : index) {
+    if (core_id.insert(make_pair(i->core().get(), core.size())).second) core.push_back(i->core());
+    if (i->has_spin()) add_spin(i->spin());
+  }
+  for (auto& d : diagram)
+    for (auto& o : d->op())
+      for (auto& r : o->rho()) add_spin(r);
+
+  Writer out;
+  for (auto& c : magic__) out.put(c);
+  out.put(eq->name());
+
+  out.put<int32_t>(spin.size());
+  for (auto& s : spin) {
+    out.put<int32_t>(s->num());
+    out.put<int8_t>(s->alpha());
+  }
+  out.put<int32_t>(core.size());
+  for (auto& c : core) {
+    out.put<int32_t>(c->space());
+    out.put<int32_t>(c->num());
+    out.put<int8_t>(c->dagger());
+  }
+  out.put<int32_t>(index.size());
+  for (auto& i : index) {
+    out.put<int32_t>(core_id[i->core().get()]);
+    out.put<int32_t>(i->has_spin() ? spin_id[i->spin().get()] : -1);
+  }
+
+  out.put<int32_t>(diagram.size());
+  for (auto& d : diagram) {
+    out.put<double>(d->fac());
+    out.put(d->scalar());
+    out.put<int8_t>(d->braket().first);
+    out.put<int8_t>(d->braket().second);
+    out.put<int8_t>(d->absorbed());
+    out.put<int8_t>(d->dagger());
+
+    out.put<int32_t>(d->op().size());
+    for (auto& o : d->op()) {
+      out.put(o->label());
+      out.put<int32_t>(o->perm().size());
+      for (auto& p : o->perm()) out.put<int32_t>(p);
+      out.put<int32_t>(o->rho().size());
+      for (auto& r : o->rho()) out.put<int32_t>(spin_id[r.get()]);
+      out.put<int32_t>(o->op().size());
+      for (auto& s : o->op()) {
+        out.put<int32_t>(index_id[get<0>(s)->get()]);
+        out.put<int8_t>(get<1>(s));
+      }
+    }
+
+    shared_ptr<Active> active = d->rdm();
+    out.put<int8_t>(static_cast<bool>(active));
+    if (!active) continue;
+    out.put<int8_t>(active->braket().first);
+    out.put<int8_t>(active->braket().second);
+    const list<shared_ptr<RDM>> rdm = active->rdm();
+    out.put<int32_t>(rdm.size());
+    for (auto& r : rdm) {
+      out.put<int8_t>(static_cast<bool>(dynamic_pointer_cast<const RDMI0>(r)));
+      out.put<double>(r->factor());
+      out.put<int8_t>(r->bra());
+      out.put<int8_t>(r->ket());
+      out.put<int32_t>(r->index().size());
+      for (auto& i : r->index()) out.put<int32_t>(index_id[i.get()]);
+      out.put<int32_t>(r->delta().size());
+      for (auto& i : r->delta()) {
+        out.put<int32_t>(index_id[i.first.get()]);
+        out.put<int32_t>(index_id[i.second.get()]);
+      }
+    }
+    const map<int, int> num_map = active->num_map();
+    out.put<int32_t>(num_map.size());
+    for (auto& i : num_map) {
+      out.put<int32_t>(i.first);
+      out.put<int32_t>(i.second);
+    }
+  }
+
+  ofstream fs(file, ios::binary);
+  fs.write(out.buf().data(), out.buf().size());
+  if (!fs) throw runtime_error("Snapshot: cannot write " + file);
+}
+
+
+shared_ptr<Equation> Snapshot::read(const string& file) {
+  Mapping m(file);
+  Reader in(m.data(), m.size());
+  for (auto& c : magic__)
+    if (in.get<char>() != c) throw runtime_error("Snapshot: " + file + " is not a snapshot of this version");
+
+  auto arena = make_shared<Arena>();
+  Arena::Scope scope(arena);
+  const string name = in.get_string();
+
+  vector<shared_ptr<Spin>> spin(in.get<int32_t>());
+  for (auto& s : spin) {
+    const int num = in.get<int32_t>();
+    s = arena_shared<Spin>(in.get<int8_t>());
+    s->set_num(num);
+  }
+  vector<shared_ptr<Index_Core>> core(in.get<int32_t>());
+  for (auto& c : core) {
+    const int space = in.get<int32_t>();
+    const int num = in.get<int32_t>();
+    c = arena_shared<Index_Core>(IndexMap::get().label(space), in.get<int8_t>());
+    c->set_num(num);
+  }
+  vector<shared_ptr<Index>> index(in.get<int32_t>());
+  for (auto& i : index) {
+    i = arena_shared<Index>(core[in.get_id(core.size())]);
+    const int s = in.get_id(spin.size(), true);
+    if (s >= 0) i->set_spin(spin[s]);
+  }
+
+  list<shared_ptr<Diagram>> diagram;
+  for (int n = in.get<int32_t>(); n > 0; --n) {
+    const double fac = in.get<double>();
+    const string scalar = in.get_string();
+    const bool bra = in.get<int8_t>();
+    const bool ket = in.get<int8_t>();
+    const bool absorbed = in.get<int8_t>();
+    const bool dagger = in.get<int8_t>();
+
+    list<shared_ptr<Operator>> op;
+    for (int k = in.get<int32_t>(); k > 0; --k) {
+      const string label = in.get_string();
+      vector<int> perm(in.get<int32_t>());
+      for (auto& p : perm) p = in.get_id(perm.size());
+      vector<int> rho(in.get<int32_t>());
+      for (auto& r : rho) r = in.get_id(spin.size());
+      const int nslot = in.get<int32_t>();
+      if (nslot != 2*static_cast<int>(perm.size())) throw runtime_error("Snapshot: broken file");
+      // pairs of slots are stored as permuted; pair perm[j] of the operator as constructed is the j-th one
+      vector<shared_ptr<Index>> slot(nslot);
+      vector<int> state(nslot);
+      for (int j = 0; j != nslot; ++j) {
+        const int s = 2*perm[j/2] + j%2;
+        slot[s] = index[in.get_id(index.size())];
+        state[s] = in.get<int8_t>();
+      }
+      // see FlatDiagram::diagram
+      shared_ptr<Operator> a;
+      switch (nslot) {
+        case 4: a = arena_shared<Op>(label, slot[0]->label(), slot[2]->label(), slot[3]->label(), slot[1]->label()); break;
+        case 2: a = arena_shared<Op>(label, slot[0]->label(), slot[1]->label()); break;
+        case 0: a = arena_shared<Op>(label); break;
+        default: throw runtime_error("Snapshot: unexpected operator");
+      }
+      if (a->rho().size() != rho.size()) throw runtime_error("Snapshot: unexpected operator");
+      for (size_t r = 0; r != rho.size(); ++r)
+        a->set_rho(r, spin[rho[r]]);
+      auto j = a->op().begin();
+      for (int s = 0; s != nslot; ++s, ++j) {
+        *get<0>(*j) = slot[s];
+        get<1>(*j) = state[s];
+      }
+      if (!is_sorted(perm.begin(), perm.end())) a->arrange(perm);
+      op.push_back(a);
+    }
+
+    auto d = arena_shared<Diagram>(op, fac, scalar, make_pair(bra, ket));
+    if (dagger) d->add_dagger();
+    d->set_absorbed(absorbed);
+
+    if (in.get<int8_t>()) {
+      const bool abra = in.get<int8_t>();
+      const bool aket = in.get<int8_t>();
+      list<shared_ptr<RDM>> rdm;
+      for (int k = in.get<int32_t>(); k > 0; --k) {
+        const bool derived = in.get<int8_t>();
+        const double rfac = in.get<double>();
+        const bool rbra = in.get<int8_t>();
+        const bool rket = in.get<int8_t>();
+        list<shared_ptr<const Index>> rindex;
+        for (int l = in.get<int32_t>(); l > 0; --l)
+          rindex.push_back(index[in.get_id(index.size())]);
+        map<shared_ptr<const Index>, shared_ptr<const Index>, IndexOrder> delta;
+        for (int l = in.get<int32_t>(); l > 0; --l) {
+          shared_ptr<const Index> first = index[in.get_id(index.size())];
+          delta.insert(make_pair(first, index[in.get_id(index.size())]));
+        }
+        if (derived)
+          rdm.push_back(make_shared<RDMI0>(rindex, delta, make_pair(rbra, rket), rfac));
+        else
+          rdm.push_back(make_shared<RDM00>(rindex, delta, make_pair(rbra, rket), rfac));
+      }
+      map<int, int> num_map;
+      for (int k = in.get<int32_t>(); k > 0; --k) {
+        const int first = in.get<int32_t>();
+        num_map[first] = in.get<int32_t>();
+      }
+      d->set_rdm(make_shared<Active>(rdm, make_pair(abra, aket), num_map));
+    }
+    diagram.push_back(d);
+  }
+  if (!in.done()) throw runtime_error("Snapshot: broken file");
+
+  return make_shared<Equation>(diagram, name, arena);
+}
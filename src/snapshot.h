@@ -0,0 +1,47 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: snapshot.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include "equation.h"
+
+namespace smith {
+
+/// Compact binary snapshots of an Equation after any of the symbolic stages in main.cc (Wick's expansion, duplicates, active), read back with mmap.
+/// Tree building and code generation can then be rerun from a snapshot without redoing those stages. Files are only meant to be read by the same build.
+class Snapshot {
+  public:
+    /// Writes the diagrams of an equation, including their operators, indices, spins and active parts.
+    static void write(const std::string& file, std::shared_ptr<Equation> eq);
+    /// Reads an equation written by write(). Indices are created in the order of the original ones, so that the generated code is the same.
+    static std::shared_ptr<Equation> read(const std::string& file);
+};
+
+}
+
+#endif
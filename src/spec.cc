@@ -0,0 +1,187 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: spec.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "spec.h"
+#include "forest.h"
+#include "residual.h"
+#include "energy.h"
+#include "stats.h"
+
+using namespace std;
+using namespace smith;
+
+Spec::Spec(const string& file) {
+  ifstream in(file);
+  if (!in.is_open())
+    throw runtime_error("Spec: could not open " + file);
+
+  string line;
+  while (getline(in, line)) {
+    stringstream ss(line);
+    string key;
+    if (!(ss >> key) || key[0] == '#') continue;
+
+    if (key == "theory") {
+      ss >> theory_;
+    } else if (key == "op") {
+      string tag, base;
+      bool alpha;
+      ss >> tag >> base >> alpha;
+      if (base == "-") base = "";
+      vector<string> index;
+      string i;
+      while (ss >> i) index.push_back(i);
+      shared_ptr<Operator> op;
+      if (index.size() == 4) {
+        op = make_shared<Op>(base, index[0], index[1], index[2], index[3], alpha);
+      } else if (index.size() == 2) {
+        op = make_shared<Op>(base, index[0], index[1], alpha);
+      } else if (index.empty()) {
+        op = make_shared<Op>(base);
+      } else {
+        throw runtime_error("Spec: operators should have zero, two or four indices: " + line);
+      }
+      op_.emplace(tag, op);
+    } else if (key == "equation") {
+      string label, type, name;
+      bool ci_derivative, simplify;
+      if (!(ss >> label >> type >> name >> ci_derivative >> simplify))
+        throw runtime_error("Spec: bad equation line: " + line);
+      tree_.emplace(label, equation(in, type, name, ci_derivative, simplify));
+    } else if (key == "trees") {
+      string label;
+      while (ss >> label) trees_.push_back(tree(label));
+    } else if (key == "print") {
+      // the title is the rest of the line after a single space, keeping its leading spaces
+      string label, title;
+      ss >> label;
+      ss.get();
+      getline(ss, title);
+      print_.push_back(make_pair(tree(label), title));
+    } else {
+      throw runtime_error("Spec: unknown keyword " + key);
+    }
+  }
+  if (trees_.empty())
+    throw runtime_error("Spec: no trees in " + file);
+}
+
+
+shared_ptr<Tree> Spec::equation(istream& in, const string type, const string name, const bool ci_derivative, const bool simplify) const {
+  list<shared_ptr<Diagram>> diagrams;
+  string line;
+  while (getline(in, line)) {
+    stringstream ss(line);
+    string key;
+    if (!(ss >> key) || key[0] == '#') continue;
+    if (key == "end") break;
+    if (key != "diagram")
+      throw runtime_error("Spec: expected a diagram: " + line);
+
+    string label, scalar;
+    double fac;
+    bool bra, ket;
+    ss >> label >> fac >> scalar >> bra >> ket;
+    if (scalar == "-") scalar = "";
+    list<shared_ptr<Operator>> ops;
+    string tag;
+    while (ss >> tag) {
+      auto iter = op_.find(tag);
+      if (iter == op_.end())
+        throw runtime_error("Spec: unknown operator " + tag);
+      ops.push_back(iter->second);
+    }
+    diagrams.push_back(make_shared<Diagram>(ops, fac, scalar, make_pair(bra, ket)));
+  }
+  if (diagrams.empty())
+    throw runtime_error("Spec: equation " + name + " has no diagrams");
+
+  list<shared_ptr<Equation>> eqs;
+  for (auto& i : diagrams)
+    eqs.push_back(make_shared<Equation>(i, theory_));
+  shared_ptr<Equation> eq = eqs.front();
+  for (auto i = ++eqs.begin(); i != eqs.end(); ++i)
+    eq->merge(*i);
+  if (ci_derivative) eq->absorb_ket();
+  eq->duplicates();
+  eq->active();
+  if (simplify) {
+    eq->reorder_tensors();
+    eq->simplify();
+  }
+
+  shared_ptr<Tree> out;
+  if (type == "residual") {
+    out = make_shared<Residual>(eq, name);
+  } else if (type == "energy") {
+    out = make_shared<Energy>(eq, name);
+  } else {
+    throw runtime_error("Spec: tree must be of derived type, not " + type);
+  }
+  return out;
+}
+
+
+shared_ptr<Tree> Spec::tree(const string label) const {
+  auto iter = tree_.find(label);
+  if (iter == tree_.end())
+    throw runtime_error("Spec: unknown tree " + label);
+  return iter->second;
+}
+
+
+void Spec::generate() const {
+  auto fr = make_shared<Forest>(trees_);
+
+  fr->filter_gamma();
+  fr->gamma();
+
+  auto tmp = fr->generate_code();
+
+  ofstream fs(fr->name() + ".h");
+  ofstream es(fr->name() + "_tasks.h");
+  ofstream cs(fr->name() + "_gen.cc");
+  ofstream ds(fr->name() + "_tasks.cc");
+  ofstream gs(fr->name() + ".cc");
+  ofstream gg(fr->name() + "_gamma.cc");
+  fs << tmp.ss.str();
+  es << tmp.tt.str();
+  cs << tmp.cc.str();
+  ds << tmp.dd.str();
+  gs << tmp.ee.str();
+  gg << tmp.gg.str();
+  Stats::get().write(fr->name() + "_stats.json");
+  cout << endl;
+
+  for (auto& i : print_) {
+    cout << endl << i.second << endl << endl;
+    i.first->print();
+  }
+  cout << endl << endl;
+}
@@ -0,0 +1,62 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: spec.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __SPEC_H
+#define __SPEC_H
+
+#include <map>
+#include <vector>
+#include "op.h"
+#include "tree.h"
+
+namespace smith {
+
+/// Equations read from a text specification printed by Prep (SMITH3_SPEC=1), so that they need not be compiled into main.cc.
+/// The specification has one line per operator, diagram, and equation, followed by the list of trees and the order in which they are printed.
+class Spec {
+  protected:
+    std::string theory_;
+    std::map<std::string, std::shared_ptr<Operator>> op_;
+    std::map<std::string, std::shared_ptr<Tree>> tree_;
+    /// Trees in the order of the forest.
+    std::list<std::shared_ptr<Tree>> trees_;
+    /// Trees printed after code generation, with their titles.
+    std::vector<std::pair<std::shared_ptr<Tree>, std::string>> print_;
+
+    /// Builds a tree from the diagrams of one equation in the same way as main.cc.
+    std::shared_ptr<Tree> equation(std::istream& in, const std::string type, const std::string name, const bool ci_derivative, const bool simplify) const;
+    std::shared_ptr<Tree> tree(const std::string label) const;
+
+  public:
+    Spec(const std::string& file);
+
+    /// Generates the code and prints the trees, as done at the end of main.cc.
+    void generate() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: stats.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+#include <sys/resource.h>
+#include "stats.h"
+
+using namespace std;
+using namespace smith;
+
+
+Stats& Stats::get() {
+  static Stats stats;
+  return stats;
+}
+
+
+Stats::Phase& Stats::phase(const string& name) {
+  auto i = find_if(phase_.begin(), phase_.end(), [&name](const pair<string, Phase>& p) { return p.first == name; });
+  if (i != phase_.end()) return i->second;
+  phase_.push_back(make_pair(name, Phase()));
+  return phase_.back().second;
+}
+
+
+void Stats::add(const string& p, const string& counter, const long n) {
+  lock_guard<mutex> lock(mutex_);
+  vector<pair<string, long>>& count = phase(p).count;
+  auto i = find_if(count.begin(), count.end(), [&counter](const pair<string, long>& c) { return c.first == counter; });
+  if (i != count.end()) i->second += n;
+  else count.push_back(make_pair(counter, n));
+}
+
+
+void Stats::set(const string& p, const string& counter, const long n) {
+  lock_guard<mutex> lock(mutex_);
+  vector<pair<string, long>>& count = phase(p).count;
+  auto i = find_if(count.begin(), count.end(), [&counter](const pair<string, long>& c) { return c.first == counter; });
+  if (i != count.end()) i->second = n;
+  else count.push_back(make_pair(counter, n));
+}
+
+
+void Stats::add_time(const string& p, const double seconds) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  lock_guard<mutex> lock(mutex_);
+  Phase& ph = phase(p);
+  ++ph.calls;
+  ph.seconds += seconds;
+  // kilobytes on Linux
+  ph.max_rss = max(ph.max_rss, static_cast<long>(usage.ru_maxrss));
+}
+
+
+string Stats::json() const {
+  lock_guard<mutex> lock(mutex_);
+  stringstream ss;
+  ss << "{" << endl;
+  ss << "  \"phases\": {";
+  for (auto i = phase_.begin(); i != phase_.end(); ++i) {
+    ss << (i == phase_.begin() ? "" : ",") << endl;
+    ss << "    \"" << i->first << "\": {" << endl;
+    ss << "      \"calls\": " << i->second.calls << "," << endl;
+    ss << "      \"seconds\": " << fixed << setprecision(6) << i->second.seconds << "," << endl;
+    ss << "      \"max_rss_kb\": " << i->second.max_rss;
+    for (auto& c : i->second.count)
+      ss << "," << endl << "      \"" << c.first << "\": " << c.second;
+    ss << endl << "    }";
+  }
+  ss << endl << "  }" << endl;
+  ss << "}" << endl;
+  return ss.str();
+}
+
+
+void Stats::write(const string& file) const {
+  ofstream fs(file);
+  if (!fs) throw runtime_error("cannot open " + file + " in Stats::write");
+  fs << json();
+}
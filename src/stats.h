@@ -0,0 +1,93 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: stats.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+namespace smith {
+
+/// Counters and timers for the phases of the generator. Written as a JSON report next to the generated sources.
+class Stats {
+  protected:
+    /// Accumulated numbers for a phase.
+    struct Phase {
+      /// Number of times the phase has been entered.
+      long calls;
+      /// Wall time in seconds.
+      double seconds;
+      /// Peak resident memory of the process in kilobytes at the end of the phase.
+      long max_rss;
+      /// Named counters in the order of first appearance.
+      std::vector<std::pair<std::string, long>> count;
+      Phase() : calls(0), seconds(0.0), max_rss(0) { }
+    };
+
+    /// Phases in the order of first appearance.
+    std::vector<std::pair<std::string, Phase>> phase_;
+    /// Protects phase_.
+    mutable std::mutex mutex_;
+
+    /// Returns a phase, which is created if not present. Should be called with mutex_ locked.
+    Phase& phase(const std::string& name);
+
+  public:
+    /// Returns the instance for this process.
+    static Stats& get();
+
+    /// Adds n to a counter of a phase. Thread safe.
+    void add(const std::string& phase, const std::string& counter, const long n = 1);
+    /// Sets a counter of a phase. Thread safe.
+    void set(const std::string& phase, const std::string& counter, const long n);
+    /// Adds the wall time of one call of a phase and records the memory usage. Thread safe.
+    void add_time(const std::string& phase, const double seconds);
+
+    /// Returns the report in JSON.
+    std::string json() const;
+    /// Writes the report to a file.
+    void write(const std::string& file) const;
+
+    /// Measures the wall time of a phase during the lifetime of this object.
+    class Timer {
+      protected:
+        /// Name of the phase.
+        std::string phase_;
+        /// Start time.
+        std::chrono::steady_clock::time_point start_;
+      public:
+        Timer(const std::string& p) : phase_(p), start_(std::chrono::steady_clock::now()) { }
+        ~Timer() { Stats::get().add_time(phase_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count()); }
+    };
+};
+
+}
+
+#endif
@@ -24,6 +24,7 @@
 
 
 #include <iomanip>
+#include <numeric>
 #include "tensor.h"
 #include "constants.h"
 
@@ -84,7 +85,7 @@ string Tensor::str() const {
   }
   ss << ")";
 
-  if (merged_) ss << " << " << merged_->str();
+  for (auto& i : merged_) ss << " << " << i->str();
   if (alias_) ss << " (" << label_ << ")";
   return ss.str();
 }
@@ -93,7 +94,7 @@ string Tensor::str() const {
 // adds all-active tensor to Active_;
 void Tensor::merge(shared_ptr<Tensor> a) {
   assert(active_);
-  merged_ = a;
+  merged_.push_back(a);
   list<list<shared_ptr<const Index>>::iterator> remove;
   // remove const Index that belongs to a
   for (auto& i : a->index()) {
@@ -110,6 +111,20 @@ void Tensor::merge(shared_ptr<Tensor> a) {
 }
 
 
+bool Tensor::contracts_all(shared_ptr<const Tensor> o) const {
+  return all_of(o->index().begin(), o->index().end(),
+                [this](shared_ptr<const Index> i) { return any_of(index_.begin(), index_.end(), [&i](shared_ptr<const Index> j) { return j->num() == i->num(); }); });
+}
+
+
+list<shared_ptr<const Index>> Tensor::merged_index() const {
+  list<shared_ptr<const Index>> out;
+  for (auto& i : merged_)
+    out.insert(out.end(), i->index().begin(), i->index().end());
+  return out;
+}
+
+
 bool Tensor::operator==(const Tensor& o) const {
   bool out = true;
   // if comparing Gammas we don't need to have similar labels or factors
@@ -135,6 +150,102 @@ bool Tensor::operator==(const Tensor& o) const {
 }
 
 
+string Tensor::gamma_key(const vector<int>& order) const {
+  if (!is_gamma() || !active_ || !merged_.empty() || !der_.empty() || order.size() != index_.size()) return "";
+  map<int, int> label;
+  auto o = order.begin();
+  for (auto& i : index_)
+    if (!label.insert(make_pair(i->num(), *o++)).second) return "";
+
+  vector<string> terms;
+  for (auto& r : active_->rdm()) {
+    // RDMs are normal ordered, so that pairs of indices can be permuted. Real <0|E|0> are also symmetric under hermitian conjugation.
+    vector<pair<int,int>> pairs;
+    for (auto i = r->index().begin(); i != r->index().end(); ++i) {
+      shared_ptr<const Index> a = *i++;
+      shared_ptr<const Index> b = *i;
+      auto la = label.find(a->num());
+      auto lb = label.find(b->num());
+      if (!a->dagger() || b->dagger() || a->spin()->alpha() || b->spin()->alpha() || la == label.end() || lb == label.end()) return "";
+      pairs.push_back(make_pair(la->second, lb->second));
+    }
+    sort(pairs.begin(), pairs.end());
+    if (DataType == "double" && !r->bra() && !r->ket()) {
+      vector<pair<int,int>> conj;
+      for (auto& i : pairs) conj.push_back(make_pair(i.second, i.first));
+      sort(conj.begin(), conj.end());
+      pairs = min(pairs, conj);
+    }
+    vector<pair<int,int>> delta;
+    for (auto& i : r->delta()) {
+      auto la = label.find(i.first->num());
+      auto lb = label.find(i.second->num());
+      if (la == label.end() || lb == label.end()) return "";
+      delta.push_back(make_pair(min(la->second, lb->second), max(la->second, lb->second)));
+    }
+    sort(delta.begin(), delta.end());
+
+    stringstream ss;
+    ss << setprecision(12) << r->factor() << " " << r->bra() << r->ket() << " (";
+    for (auto& i : pairs) ss << i.first << "," << i.second << " ";
+    ss << ")(";
+    for (auto& i : delta) ss << i.first << "," << i.second << " ";
+    ss << ")";
+    terms.push_back(ss.str());
+  }
+  sort(terms.begin(), terms.end());
+  stringstream ss;
+  for (auto& i : terms) ss << i << ";";
+  return ss.str();
+}
+
+
+vector<vector<int>> Tensor::gamma_orders() const {
+  vector<vector<int>> out;
+  const int size = index_.size();
+  if (size & 1) return out;
+  // indices of a Gamma come in pairs of daggered and non-daggered ones
+  const vector<shared_ptr<const Index>> index(index_.begin(), index_.end());
+  for (int k = 0; k != size; k += 2)
+    if (!index[k]->dagger() || index[k+1]->dagger()) return out;
+
+  vector<int> pairs(size/2);
+  iota(pairs.begin(), pairs.end(), 0);
+  do {
+    for (int swap = 0; swap != 2; ++swap) {
+      vector<int> order(size);
+      for (int k = 0; k != size/2; ++k) {
+        order[2*k]   = 2*pairs[k] + swap;
+        order[2*k+1] = 2*pairs[k] + 1 - swap;
+      }
+      out.push_back(order);
+    }
+  } while (next_permutation(pairs.begin(), pairs.end()));
+  return out;
+}
+
+
+string Tensor::fingerprint() const {
+  // the fields compared in operator== for Gammas
+  auto str = [](const shared_ptr<const Index>& i) {
+    stringstream ss;
+    ss << i->space() << "." << i->num() << (i->has_spin() ? (i->spin()->alpha() ? "*" : "") : "-") << " ";
+    return ss.str();
+  };
+  stringstream ss;
+  ss << setprecision(17);
+  for (auto& i : index_) ss << str(i);
+  if (active_) {
+    for (auto& r : active_->rdm()) {
+      ss << "[" << r->factor() << " " << r->bra() << r->ket() << " " << r->delta().size() << " ";
+      for (auto& i : r->index()) ss << str(i);
+      ss << "]";
+    }
+  }
+  return ss.str();
+}
+
+
 string Tensor::constructor_str(const bool diagonal) const {
   stringstream ss;
   string indent = "";
@@ -197,7 +308,7 @@ string Tensor::generate_get_block(const string cindent, const string lab, const
 
   stringstream tt;
   // for scalar.
-  if (index_.empty() && merged_) {
+  if (index_.empty() && !merged_.empty()) {
 #ifdef debug_tasks
    tt << cindent << "// scalar" << endl;
 #endif
@@ -439,16 +550,18 @@ pair<string, string> Tensor::generate_dim(const list<shared_ptr<const Index>>& d
 string Tensor::generate_active_sources(string indent, const string tag, const int ninptensors, const bool use_blas, const shared_ptr<Tensor> source) const {
   assert(label_.find("Gamma") != string::npos);
   stringstream dd;
-  if (!merged_) {
+  if (merged_.empty()) {
     dd << active()->generate_sources(indent, tag, index());
   } else {
+    if (merged_.size() > 1)
+      throw logic_error("Tensor::generate_active_sources: derivative Gammas with more than one merged tensor are not implemented");
 
 #ifdef debug_tasks
     dd << indent <<"// associated with merged" << endl;
 #endif
 
     // add fdata
-    list<shared_ptr<const Index>>& merged = merged_->index();
+    list<shared_ptr<const Index>> merged = merged_index();
     // fdata tensor should be last to mirror gamma footer
     dd << indent << "std::unique_ptr<" << DataType << "[]> fdata = in(1)->get_block(";
     for (auto j = merged.rbegin(); j != merged.rend(); ++j) {
@@ -458,7 +571,7 @@ string Tensor::generate_active_sources(string indent, const string tag, const in
     dd << ");" << endl;
 
     // generate merged and/or rdm
-    dd << active()->generate_sources(indent, tag, index(), merged_->index(), merged_->label(), use_blas);
+    dd << active()->generate_sources(indent, tag, index(), merged, {merged_.front()->label()}, use_blas);
 
   }
   return dd.str();
@@ -469,7 +582,7 @@ string Tensor::generate_active_sources(string indent, const string tag, const in
 string Tensor::generate_active(string indent, const string tag, const int ninptensors, const bool use_blas) const {
   assert(label_.find("Gamma") != string::npos);
   stringstream dd;
-  if (!merged_) {
+  if (merged_.empty()) {
     dd << active()->generate(indent, tag, index());
   } else {
 
@@ -478,17 +591,51 @@ string Tensor::generate_active(string indent, const string tag, const int ninpte
 #endif
 
     // add fdata
-    list<shared_ptr<const Index>>& merged = merged_->index();
-    // fdata tensor should be last to mirror gamma footer
-    dd << indent << "std::unique_ptr<" << DataType << "[]> fdata = in("<< ninptensors-1 << ")->get_block(";
-    for (auto j = merged.rbegin(); j != merged.rend(); ++j) {
-      if (j != merged.rbegin()) dd << ", ";
-      dd << (*j)->str_gen();
+    list<shared_ptr<const Index>> merged = merged_index();
+    vector<string> mlab;
+    // fdata tensors should be last to mirror gamma footer
+    if (merged_.size() == 1) {
+      dd << indent << "std::unique_ptr<" << DataType << "[]> fdata = in("<< ninptensors-1 << ")->get_block(";
+      for (auto j = merged.rbegin(); j != merged.rend(); ++j) {
+        if (j != merged.rbegin()) dd << ", ";
+        dd << (*j)->str_gen();
+      }
+      dd << ");" << endl;
+      mlab.push_back(merged_.front()->label());
+    } else {
+      // a chain of merged tensors is multiplied into fdata, whose layout is the same as that of a single tensor with the indices of all of them
+      vector<string> size;
+      int n = ninptensors - merged_.size();
+      for (auto& i : merged_) {
+        stringstream ss, tt;
+        for (auto j = i->index().rbegin(); j != i->index().rend(); ++j)
+          ss << (j != i->index().rbegin() ? ", " : "") << (*j)->str_gen();
+        tt << "in(" << n << ")->get_size(" << ss.str() << ")";
+        dd << indent << "std::unique_ptr<" << DataType << "[]> fdata" << mlab.size() << " = in(" << n << ")->get_block(" << ss.str() << ");" << endl;
+        size.push_back(tt.str());
+        mlab.push_back(i->label());
+        ++n;
+      }
+      dd << indent << "std::unique_ptr<" << DataType << "[]> fdata(new " << DataType << "[";
+      for (auto i = size.begin(); i != size.end(); ++i)
+        dd << (i != size.begin() ? "*" : "") << *i;
+      dd << "]);" << endl;
+      string lindent = indent;
+      for (int i = 0; i != size.size(); ++i, lindent += "  ")
+        dd << lindent << "for (size_t j" << i << " = 0; j" << i << " != " << size[i] << "; ++j" << i << ")" << endl;
+      dd << lindent << "fdata[";
+      for (int i = size.size()-1; i > 0; --i)
+        dd << "j" << i << "+" << size[i] << "*(";
+      dd << "j0" << string(size.size()-1, ')') << "] = ";
+      for (int i = 0; i != size.size(); ++i)
+        dd << (i ? " * " : "") << "fdata" << i << "[j" << i << "]";
+      dd << ";" << endl;
     }
-    dd << ");" << endl;
 
     if (use_blas) {
-      dd << indent << "std::unique_ptr<" << DataType << "[]> fdata_sorted(new " << DataType << "["<< merged_->label() << "->get_size(fhash)]);" << endl;
+      if (merged_.size() > 1)
+        throw logic_error("Tensor::generate_active: blas is not implemented for more than one merged tensor");
+      dd << indent << "std::unique_ptr<" << DataType << "[]> fdata_sorted(new " << DataType << "["<< merged_.front()->label() << "->get_size(fhash)]);" << endl;
 
       // make sort_indices for merged op
       vector<int> done;
@@ -522,7 +669,7 @@ string Tensor::generate_active(string indent, const string tag, const int ninpte
     }
 
     // generate merged and/or rdm
-    dd << active()->generate(indent, tag, index(), merged_->index(), merged_->label(), use_blas);
+    dd << active()->generate(indent, tag, index(), merged, mlab, use_blas);
 
   }
   return dd.str();
@@ -547,21 +694,12 @@ OutStream Tensor::generate_gamma_sources(const int ic, const bool use_blas, cons
   int nindex;
   list<shared_ptr<const Index>> merged;
 
-  if (merged_) {
-    merged = merged_->index();
-    nindex = index_.size() + merged.size();
-  } else {
-    nindex = index_.size();
-  }
+  merged = merged_index();
+  nindex = index_.size() + merged.size();
 
   // determine number of tensors
   vector<string> rdmn = active()->required_rdm();
-  int ninptensors;
-  if (merged_) {
-    ninptensors = rdmn.size()+1;
-  } else {
-    ninptensors = rdmn.size();
-  }
+  int ninptensors = rdmn.size() + merged_.size();
 
   out << generate_gamma_header_sources(ic, use_blas, der, nindex);
   out << generate_gamma_body_sources(ic, use_blas, der, nindex, ninptensors, merged, source, di);
@@ -574,6 +712,8 @@ OutStream Tensor::generate_gamma_sources(const int ic, const bool use_blas, cons
 OutStream Tensor::generate_gamma(const int ic, const bool use_blas, const bool der) const {
   assert(label_.find("Gamma") != string::npos);
   OutStream out;
+  if (der && merged_.size() > 1)
+    throw logic_error("Tensor::generate_gamma: derivative Gammas with more than one merged tensor are not implemented");
 
   // if it is derivative code, do not generate anything
   if (der) return out;
@@ -582,21 +722,12 @@ OutStream Tensor::generate_gamma(const int ic, const bool use_blas, const bool d
   int nindex;
   list<shared_ptr<const Index>> merged;
 
-  if (merged_) {
-    merged = merged_->index();
-    nindex = index_.size() + merged.size();
-  } else {
-    nindex = index_.size();
-  }
+  merged = merged_index();
+  nindex = index_.size() + merged.size();
 
   // determine number of tensors
   vector<string> rdmn = active()->required_rdm();
-  int ninptensors;
-  if (merged_) {
-    ninptensors = rdmn.size()+1;
-  } else {
-    ninptensors = rdmn.size();
-  }
+  int ninptensors = rdmn.size() + merged_.size();
 
   out << generate_gamma_header(ic, use_blas, der, nindex, ninptensors);
   out << generate_gamma_body(ic, use_blas, der, nindex, ninptensors, merged);
@@ -615,8 +746,8 @@ OutStream Tensor::generate_gamma_header_sources(const int ic, const bool use_bla
 #endif
   out.tt << "  protected:" << endl;
   out.tt << "    std::array<std::shared_ptr<Tensor>,5> out_;" << endl;
-  out.tt << "    std::array<std::shared_ptr<const Tensor>," << (merged_? "2":"1") << "> in_;" << endl;
-  out.tt << "    class Task_local : public SubTask_Merged<" << nindex << "," << (merged_? "2":"1") << ",5> {" << endl;    // five here is output tensors
+  out.tt << "    std::array<std::shared_ptr<const Tensor>," << (merged_.empty() ? "1" : "2") << "> in_;" << endl;
+  out.tt << "    class Task_local : public SubTask_Merged<" << nindex << "," << (merged_.empty() ? "1" : "2") << ",5> {" << endl;    // five here is output tensors
   out.tt << "      protected:" << endl;
   out.tt << "        const std::array<std::shared_ptr<const IndexRange>,3> range_;" << endl;
   out.tt << endl;
@@ -626,10 +757,10 @@ OutStream Tensor::generate_gamma_header_sources(const int ic, const bool use_bla
   out.tt << "        std::shared_ptr<Tensor> out(const size_t& i) { return this->out_tensor(i); }" << endl;
   out.tt << endl;
   out.tt << "      public:" << endl;
-  out.tt << "        Task_local(const std::array<const Index," << nindex << ">& block, const std::array<std::shared_ptr<const Tensor>," << (merged_? "2":"1") <<  ">& in," << endl;
+  out.tt << "        Task_local(const std::array<const Index," << nindex << ">& block, const std::array<std::shared_ptr<const Tensor>," << (merged_.empty() ? "1" : "2") <<  ">& in," << endl;
   out.tt << "                   const std::array<std::shared_ptr<Tensor>,5>& out,";
   out.tt << " std::array<std::shared_ptr<const IndexRange>,3>& ran)" << endl;
-  out.tt << "          : SubTask_Merged<" << nindex << "," << (merged_? "2":"1") << ",5>(block, in, out), range_(ran) { }" << endl;
+  out.tt << "          : SubTask_Merged<" << nindex << "," << (merged_.empty() ? "1" : "2") << ",5>(block, in, out), range_(ran) { }" << endl;
   out.tt << endl;
   out.tt << endl;
   out.tt << "        void compute() override;" << endl;
@@ -648,7 +779,7 @@ OutStream Tensor::generate_gamma_body_sources(const int ic, const bool use_blas,
   for (auto i = index_.rbegin(); i != index_.rend(); ++i, bcnt++) {
     out.dd << indent << "const Index " << (*i)->str_gen() << " = b(" << bcnt << ");" << endl;
   }
-  if (merged_) {
+  if (!merged_.empty()) {
     for (auto i = merged.rbegin(); i != merged.rend(); ++i, bcnt++)
       out.dd << indent << "const Index " << (*i)->str_gen() << " = b(" << bcnt << ");" << endl;
   }
@@ -662,7 +793,7 @@ OutStream Tensor::generate_gamma_body_sources(const int ic, const bool use_blas,
   out.dd << indent << "// tensor label (calculated on-the-fly): " << label() << endl;
 #endif
   // TODO currently not considering blas
-  if (merged_) {
+  if (!merged_.empty()) {
     if (use_blas && !index_.empty()) out.dd << generate_scratch_area(indent, "o", "out", true);
   }
   // now generate codes for rdm
@@ -699,11 +830,11 @@ OutStream Tensor::generate_gamma_footer_sources(const int ic, const bool use_bla
   out.tt << "    Task" << ic << "(std::vector<std::shared_ptr<Tensor>> t, std::array<std::shared_ptr<const IndexRange>,3> range);" << endl;
 
   out.cc << "Task" << ic << "::Task" << ic << "(vector<shared_ptr<Tensor>> t, array<shared_ptr<const IndexRange>,3> range) {" << endl;
-  out.cc << "  array<shared_ptr<const Tensor>," << (merged_? "2" : "1") << "> in = {{";
+  out.cc << "  array<shared_ptr<const Tensor>," << (merged_.empty() ? "1" : "2") << "> in = {{";
 
   // write out tensors in increasing order
-  for (auto i = 1;  i < (merged_? 2 : 1) + 1; ++i)
-    out.cc << "t[" << i+4 << "]" << (i == (merged_? 2 : 1) ? "" : ", ");
+  for (auto i = 1;  i < (merged_.empty() ? 1 : 2) + 1; ++i)
+    out.cc << "t[" << i+4 << "]" << (i == (merged_.empty() ? 1 : 2) ? "" : ", ");
   out.cc << "}};" << endl;
 
   out.cc << "  array<shared_ptr<Tensor>,5> out = {{t[0], t[1], t[2], t[3], t[4]}};" << endl;
@@ -717,7 +848,7 @@ OutStream Tensor::generate_gamma_footer_sources(const int ic, const bool use_bla
       if (i != index_.rbegin()) out.cc << "*";
       out.cc << (*i)->generate_range() << "->nblock()";
     }
-    if (merged_){
+    if (!merged_.empty()) {
       for (auto i = merged.rbegin(); i != merged.rend(); ++i) {
         out.cc << "*" << (*i)->generate_range() << "->nblock()";
       }
@@ -728,7 +859,7 @@ OutStream Tensor::generate_gamma_footer_sources(const int ic, const bool use_bla
   string cindent = "  ";
   for (auto i = index_.rbegin(); i != index_.rend(); ++i, cindent += "  ")
     out.cc << cindent << "for (auto& " << (*i)->str_gen() << " : *" << (*i)->generate_range() << ")" << endl;
-  if (merged_)
+  if (!merged_.empty())
     for (auto i = merged.rbegin(); i != merged.rend(); ++i, cindent += "  ")
       out.cc << cindent << "for (auto& " << (*i)->str_gen() << " : *" << (*i)->generate_range() << ")" << endl;
   // parallel if
@@ -742,7 +873,7 @@ OutStream Tensor::generate_gamma_footer_sources(const int ic, const bool use_bla
   cindent += "  ";
   // add subtasks
   out.cc << cindent  << "subtasks_.push_back(make_shared<Task_local>(array<const Index," << nindex << ">{{" << listind;
-  if (merged_) {
+  if (!merged_.empty()) {
     out.cc << (index_.empty() ? "" : ", ");
     for (auto i = merged.rbegin(); i != merged.rend(); ++i) {
       out.cc << (*i)->str_gen();
@@ -801,14 +932,14 @@ OutStream Tensor::generate_gamma_body(const int ic, const bool use_blas, const b
   int bcnt = 0;
   for (auto i = index_.rbegin(); i != index_.rend(); ++i, bcnt++)
     out.dd << indent << "const Index " << (*i)->str_gen() << " = b(" << bcnt << ");" << endl;
-  if (merged_) {
+  if (!merged_.empty()) {
     for (auto i = merged.rbegin(); i != merged.rend(); ++i, bcnt++)
       out.dd << indent << "const Index " << (*i)->str_gen() << " = b(" << bcnt << ");" << endl;
   }
 
   // generate gamma get block, true does a move_block
   out.dd << generate_get_block(indent, "o", "out()", /*move=*/true, /*noscale=*/true);
-  if (merged_) {
+  if (!merged_.empty()) {
     if (use_blas && !index_.empty()) out.dd << generate_scratch_area(indent, "o", "out", true);
   }
   // now generate codes for rdm
@@ -859,7 +990,7 @@ OutStream Tensor::generate_gamma_footer(const int ic, const bool use_blas, const
       if (i != index_.rbegin()) out.cc << "*";
       out.cc << (*i)->generate_range() << "->nblock()";
     }
-    if (merged_){
+    if (!merged_.empty()) {
       for (auto i = merged.rbegin(); i != merged.rend(); ++i) {
         out.cc << "*" << (*i)->generate_range() << "->nblock()";
       }
@@ -870,7 +1001,7 @@ OutStream Tensor::generate_gamma_footer(const int ic, const bool use_blas, const
   string cindent = "  ";
   for (auto i = index_.rbegin(); i != index_.rend(); ++i, cindent += "  ")
     out.cc << cindent << "for (auto& " << (*i)->str_gen() << " : *" << (*i)->generate_range() << ")" << endl;
-  if (merged_) {
+  if (!merged_.empty()) {
     for (auto i = merged.rbegin(); i != merged.rend(); ++i, cindent += "  ")
       out.cc << cindent << "for (auto& " << (*i)->str_gen() << " : *" << (*i)->generate_range() << ")" << endl;
   }
@@ -884,7 +1015,7 @@ OutStream Tensor::generate_gamma_footer(const int ic, const bool use_blas, const
   cindent += "  ";
   // add subtasks
   out.cc << cindent  << "subtasks_.push_back(make_shared<Task_local>(array<const Index," << nindex << ">{{" << listind;
-  if (merged_) {
+  if (!merged_.empty()) {
     out.cc << (index_.empty() ? "" : ", ");
     for (auto i = merged.rbegin(); i != merged.rend(); ++i) {
       out.cc << (*i)->str_gen();
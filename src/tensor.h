@@ -54,8 +54,8 @@ class Tensor {
 
     /// If this tensor is active, it has an internal structure.
     std::shared_ptr<Active> active_;
-    /// If merged, tensor should be multiplied by additional tensor.
-    std::shared_ptr<Tensor> merged_;
+    /// If merged, tensor should be multiplied by additional all-active tensors, in this order.
+    std::list<std::shared_ptr<Tensor>> merged_;
 
     /// Alias tensor if any.
     std::shared_ptr<Tensor> alias_;
@@ -87,8 +87,10 @@ class Tensor {
     /// Returns const list of index pointers for tensor.
     const std::list<std::shared_ptr<const Index>>& index() const { return index_; }
 
-    /// Returns const Tensor pointer.
-    const std::shared_ptr<const Tensor> merged() const { return merged_; }
+    /// Returns the merged tensors.
+    const std::list<std::shared_ptr<Tensor>>& merged() const { return merged_; }
+    /// Returns the indices of the merged tensors, in the order of the tensors.
+    std::list<std::shared_ptr<const Index>> merged_index() const;
 
     /// Returns tensor rank, cannot be called by DF tensors so far.
     int rank() const {
@@ -118,13 +120,23 @@ class Tensor {
     const std::shared_ptr<Active> active() const { return active_; }
 
     /// Returns true if all the indices are of active orbitals.
-    bool all_active() const { std::all_of(index_.begin(), index_.end(), [](std::shared_ptr<const Index> i){ return i->active(); }); }
+    bool all_active() const { return std::all_of(index_.begin(), index_.end(), [](std::shared_ptr<const Index> i){ return i->active(); }); }
 
     /// Used for factorization of trees.
     bool operator==(const Tensor& o) const;
-
-    /// Adds all-active tensor to Active_.
+    /// Returns a key of this Gamma in which the index at each position is labeled by order. The key is invariant under the permutation of pairs
+    /// in each RDM and, for real RDMs, under hermiticity. Empty for tensors that are not simple Gammas.
+    std::string gamma_key(const std::vector<int>& order) const;
+    /// Returns the orders of indices of this Gamma under which gamma_key may match another Gamma: pairs of daggered and non-daggered indices are
+    /// permuted, and swapped for hermiticity. Empty if the indices do not come in such pairs.
+    std::vector<std::vector<int>> gamma_orders() const;
+    /// Returns a string that is the same for Gammas if and only if they are equal (operator==). Used as a hash key.
+    std::string fingerprint() const;
+
+    /// Adds all-active tensor to Active_. Tensors merged one after another are multiplied with each other in the Gamma task.
     void merge(std::shared_ptr<Tensor> o);
+    /// Checks if every index of tensor o is contracted with an index of this tensor.
+    bool contracts_all(std::shared_ptr<const Tensor> o) const;
     /// Sets alias used for equivalent Gamma tensor. Used in Tree::find_gamma(). The alias is given to tensor o.
     void set_alias(std::shared_ptr<Tensor> o) { alias_ = o; }
     /// if tensor is a repeat.
@@ -0,0 +1,107 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: threadpool.cc
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <cstdlib>
+#include <algorithm>
+#include "threadpool.h"
+
+using namespace std;
+using namespace smith;
+
+/// True on worker threads of any pool; nested parallel_for calls are then run serially.
+static thread_local bool on_worker = false;
+
+ThreadPool::ThreadPool(const int n) : stop_(false) {
+  for (int i = 1; i < n; ++i)
+    worker_.emplace_back(&ThreadPool::work, this);
+}
+
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& i : worker_) i.join();
+}
+
+
+void ThreadPool::work() {
+  on_worker = true;
+  while (true) {
+    packaged_task<void()> task;
+    {
+      unique_lock<mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      task = move(queue_.front());
+      queue_.pop_front();
+    }
+    task();
+  }
+}
+
+
+future<void> ThreadPool::submit(function<void()> f) {
+  packaged_task<void()> task(f);
+  future<void> out = task.get_future();
+  {
+    lock_guard<mutex> lock(mutex_);
+    queue_.push_back(move(task));
+  }
+  cv_.notify_one();
+  return out;
+}
+
+
+size_t ThreadPool::num_slices(const size_t n, const size_t grain) const {
+  if (on_worker) return 1;
+  return max(min(static_cast<size_t>(size()), n/max(grain, static_cast<size_t>(1))), static_cast<size_t>(1));
+}
+
+
+size_t ThreadPool::parallel_for(const size_t n, const size_t grain, function<void(const size_t, const size_t, const size_t)> f) {
+  const size_t nslice = num_slices(n, grain);
+  // slice i covers [n*i/nslice, n*(i+1)/nslice)
+  vector<future<void>> task;
+  for (size_t i = 1; i < nslice; ++i)
+    task.push_back(submit([=]() { f(i, n*i/nslice, n*(i+1)/nslice); }));
+  f(0, 0, n/nslice);
+  // waits for all the slices first, then rethrows the first exception, if any
+  for (auto& i : task) i.wait();
+  for (auto& i : task) i.get();
+  return nslice;
+}
+
+
+ThreadPool& ThreadPool::get() {
+  static ThreadPool pool([]() {
+    const char* env = getenv("SMITH3_NUM_THREADS");
+    const int n = env ? atoi(env) : thread::hardware_concurrency();
+    return max(n, 1);
+  }());
+  return pool;
+}
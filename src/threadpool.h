@@ -0,0 +1,79 @@
+//
+// SMITH3 - generates spin-free multireference electron correlation programs.
+// Filename: threadpool.h
+// Copyright (C) 2012 Toru Shiozaki
+//
+// Author: Toru Shiozaki <shiozaki@northwestern.edu>
+// Maintainer: Shiozaki group
+//
+// This file is part of the SMITH3 package.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef __THREADPOOL_H
+#define __THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+
+namespace smith {
+
+/// A simple pool of worker threads shared by the stages of the generator.
+class ThreadPool {
+  protected:
+    /// Worker threads.
+    std::vector<std::thread> worker_;
+    /// Queue of tasks waiting for a worker.
+    std::deque<std::packaged_task<void()>> queue_;
+    /// Guards queue_ and stop_.
+    std::mutex mutex_;
+    /// Signals workers when a task is queued or the pool is stopped.
+    std::condition_variable cv_;
+    /// If true, workers exit once the queue is empty.
+    bool stop_;
+
+    /// Main loop of each worker.
+    void work();
+
+  public:
+    /// Construct pool with n threads, including the calling one (i.e., n-1 workers are spawned).
+    ThreadPool(const int n);
+    ~ThreadPool();
+
+    /// Number of threads including the calling one.
+    int size() const { return worker_.size()+1; }
+
+    /// Queues a task and returns its future. Exceptions thrown by the task are rethrown by std::future::get().
+    std::future<void> submit(std::function<void()> f);
+
+    /// Splits [0, n) into contiguous slices and calls f(slice, begin, end) for each, slice 0 on the calling thread. Returns the number of slices after all of them are done.
+    /// Slices never contain less than grain elements; when called from a worker, the whole range is processed on that thread as one slice.
+    size_t parallel_for(const size_t n, const size_t grain, std::function<void(const size_t, const size_t, const size_t)> f);
+    /// Returns the number of slices parallel_for will use for n elements.
+    size_t num_slices(const size_t n, const size_t grain) const;
+
+    /// Returns the pool of the process. The number of threads is taken from SMITH3_NUM_THREADS if set, otherwise from the hardware.
+    static ThreadPool& get();
+};
+
+}
+
+#endif
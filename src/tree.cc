@@ -26,14 +26,17 @@
 #include "energy.h"
 #include "residual.h"
 #include "constants.h"
+#include "stats.h"
 
 using namespace std;
 using namespace smith;
 
 
 Tree::Tree(shared_ptr<Equation> eq, string lab) : parent_(NULL), tree_name_(eq->name()), num_(-1), label_(lab), root_targets_(eq->targets()) {
+  Stats::Timer timer("tree");
   // First make ListTensor for all the diagrams
   list<shared_ptr<Diagram>> d = eq->diagram();
+  Stats::get().add("tree", "diagrams", d.size());
 
   const bool rt_targets = eq->targets();
 
@@ -227,22 +230,29 @@ shared_ptr<Tensor> BinaryContraction::next_target() {
 
 
 void Tree::sort_gamma(list<shared_ptr<Tensor>> o) {
-  gamma_ = o;
+  gamma_ = GammaTable(o);
   list<shared_ptr<Tensor>> g = gather_gamma();
   for (auto& i : g) find_gamma(i);
 }
 
 
 void Tree::find_gamma(shared_ptr<Tensor> o) {
-  bool found = false;
-  for (auto& i : gamma_) {
-    if ((*i) == (*o)) {
-      found = true;
-      o->set_alias(i);
-      break;
-    }
+  shared_ptr<Tensor> same = gamma_.find(*o);
+  if (same) {
+    o->set_alias(same);
+    return;
+  }
+  // Gammas equal to an existing one up to the order of indices are read from it with the indices permuted
+  pair<shared_ptr<Tensor>, vector<int>> permuted = gamma_.find_permuted(*o);
+  if (permuted.first) {
+    vector<shared_ptr<const Index>> index(permuted.second.size());
+    auto k = permuted.second.begin();
+    for (auto& j : o->index()) index[*k++] = j;
+    o->set_index(list<shared_ptr<const Index>>(index.begin(), index.end()));
+    o->set_alias(permuted.first);
+    return;
   }
-  if (!found) gamma_.push_back(o);
+  gamma_.add(o);
 }
 
 
@@ -790,7 +800,7 @@ tuple<OutStream, int, vector<shared_ptr<Tensor>>>
   // saving a counter to a protected member for dependency checks
   num_ = tcnt;
   bool merged = false;
-  if (source_tensors[1]->merged()) merged = true;
+  if (!source_tensors[1]->merged().empty()) merged = true;
   // if gamma, output is _0 ... _5. if rdm0deriv_, output is only _0
   if (source_tensors[1]->label().find("Gamma") != string::npos)
     out << generate_task_gamma(num_, source_tensors, gamma, t0, diagonal, true, merged);
@@ -28,6 +28,7 @@
 
 #include "equation.h"
 #include "listtensor.h"
+#include "gammatable.h"
 
 namespace smith {
 
@@ -151,7 +152,7 @@ class Tree {
     BinaryContraction* parent_;
 
     /// This is only used for finding gamma with in the tree.
-    std::list<std::shared_ptr<Tensor>> gamma_;
+    GammaTable gamma_;
 
     /// For code generation.
     std::string tree_name_;
@@ -233,7 +234,7 @@ class Tree {
     /// Recursive function to collect all Gamma tensors in graph.
     std::list<std::shared_ptr<Tensor>> gather_gamma() const;
     /// Returns gamma_, list of unique Gamma tensors.
-    std::list<std::shared_ptr<Tensor>> gamma() const { return gamma_; }
+    std::list<std::shared_ptr<Tensor>> gamma() const { return gamma_.gamma(); }
 
     /// Returns if this tree should be computed only for diagonals
     bool diagonal_only() const { return gather_gamma().empty() && nogamma_upstream(); }